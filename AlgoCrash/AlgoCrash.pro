@@ -1,5 +1,5 @@
 QT       += core gui widgets
-CONFIG   += c++17
+CONFIG   += c++20 thread
 
 TEMPLATE = app
 TARGET = AlgoCrash
@@ -10,10 +10,28 @@ INCLUDEPATH += third_party
 
 # App sources
 SOURCES += \
+    src/arrayviewitem.cpp \
+    src/blockarrayitem.cpp \
+    src/blockpool.cpp \
+    src/cachemodel.cpp \
+    src/datasetgenerator.cpp \
+    src/datasetloader.cpp \
+    src/externalsort.cpp \
+    src/frameexporter.cpp \
+    src/labelatlas.cpp \
     src/main.cpp \
     src/mainwindow.cpp \
+    src/mappedfile.cpp \
+    src/parallelsort.cpp \
     src/physicsblock.cpp \
+    src/physicsworld.cpp \
+    src/replayfile.cpp \
+    src/simdsort.cpp \
     src/sortingcontroller.cpp \
+    src/sortengine.cpp \
+    src/tween.cpp \
+    src/undolog.cpp \
+    src/workstealingpool.cpp \
     third_party/Box2D/Collision/b2BroadPhase.cpp \
     third_party/Box2D/Collision/b2CollideCircle.cpp \
     third_party/Box2D/Collision/b2CollideEdge.cpp \
@@ -63,10 +81,30 @@ SOURCES += \
 
 
 HEADERS += \
+    include/arrayviewitem.h \
+    include/blockarrayitem.h \
+    include/blockpool.h \
+    include/cachemodel.h \
+    include/datasetgenerator.h \
+    include/datasetloader.h \
+    include/externalsort.h \
+    include/frameexporter.h \
+    include/labelatlas.h \
     include/mainwindow.h \
+    include/mappedfile.h \
     $$files(third_party/Box2D/**/*.h, true) \
+    include/parallelsort.h \
     include/physicsblock.h \
-    include/sortingcontroller.h
+    include/physicsworld.h \
+    include/replayfile.h \
+    include/simdsort.h \
+    include/sortingcontroller.h \
+    include/sortengine.h \
+    include/sortstepper.h \
+    include/sorttrace.h \
+    include/tween.h \
+    include/undolog.h \
+    include/workstealingpool.h
 
 # UI Forms
 FORMS += ui/mainwindow.ui
@@ -0,0 +1,33 @@
+# Headless benchmark of the sorting algorithms (no Qt, no Box2D).
+# Build:  qmake benchmark.pro && make
+# Run:    ./AlgoCrashBenchmark --output results.json
+
+QT      -=  core gui
+CONFIG  +=  console c++20 thread
+CONFIG  -=  app_bundle qt
+
+TEMPLATE = app
+TARGET = AlgoCrashBenchmark
+
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+INCLUDEPATH += ../include
+
+SOURCES += \
+    main.cpp \
+    ../src/cachemodel.cpp \
+    ../src/datasetgenerator.cpp \
+    ../src/parallelsort.cpp \
+    ../src/simdsort.cpp \
+    ../src/sortengine.cpp \
+    ../src/workstealingpool.cpp
+
+HEADERS += \
+    ../include/cachemodel.h \
+    ../include/datasetgenerator.h \
+    ../include/parallelsort.h \
+    ../include/simdsort.h \
+    ../include/sortengine.h \
+    ../include/sortstepper.h \
+    ../include/sorttrace.h \
+    ../include/workstealingpool.h
@@ -0,0 +1,247 @@
+/**
+ * benchmark/main.cpp
+ *
+ * This file contains the entry point of the headless sorting benchmark. It
+ * runs every SortEngine algorithm over generated inputs of several shapes
+ * and sizes and writes wall time, operation counts and memory traffic as
+ * JSON. std::sort and the SimdSort kernels of every supported instruction
+ * set run on the same inputs as baselines (without operation counts).
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "datasetgenerator.h"
+#include "simdsort.h"
+#include "sortengine.h"
+#include "workstealingpool.h"
+
+namespace {
+    /**
+     * Input shapes the algorithms are measured on
+     */
+    enum Shape { RANDOM, SORTED, REVERSED, FEW_UNIQUE, ORGAN_PIPE, GAUSSIAN, ZIPF, NEARLY_SORTED,
+                 SAWTOOTH };
+    constexpr Shape kShapes[] = { RANDOM, SORTED, REVERSED, FEW_UNIQUE, ORGAN_PIPE, GAUSSIAN, ZIPF,
+                                  NEARLY_SORTED, SAWTOOTH };
+
+    const char* shapeName(Shape s)
+    {
+        switch (s) {
+        case RANDOM:        return "random";
+        case SORTED:        return "sorted";
+        case REVERSED:      return "reversed";
+        case FEW_UNIQUE:    return "few-unique";
+        case ORGAN_PIPE:    return "organ-pipe";
+        case GAUSSIAN:      return DatasetGenerator::name(DatasetGenerator::GAUSSIAN);
+        case ZIPF:          return DatasetGenerator::name(DatasetGenerator::ZIPF);
+        case NEARLY_SORTED: return DatasetGenerator::name(DatasetGenerator::NEARLY_SORTED);
+        case SAWTOOTH:      return DatasetGenerator::name(DatasetGenerator::SAWTOOTH);
+        }
+        return "unknown";
+    }
+
+    std::vector<int> generate(Shape s, size_t n, uint32_t seed)
+    {
+        using Gen = DatasetGenerator;
+        switch (s) {
+        case RANDOM:
+            return Gen(Gen::UNIFORM, n, seed, double(std::min<size_t>(n, 1u << 30)) + 1).generate();
+        case SORTED: {
+            std::vector<int> keys(n);
+            std::iota(keys.begin(), keys.end(), 0);
+            return keys;
+        }
+        case REVERSED:
+            return Gen(Gen::REVERSED, n, seed).generate();
+        case FEW_UNIQUE:
+            return Gen(Gen::MANY_DUPLICATES, n, seed, 8).generate();
+        case ORGAN_PIPE: {
+            std::vector<int> keys(n);
+            for (size_t i = 0; i < n; ++i)
+                keys[i] = int(std::min(i, n - 1 - i));
+            return keys;
+        }
+        case GAUSSIAN:
+            return Gen(Gen::GAUSSIAN, n, seed).generate();
+        case ZIPF:
+            return Gen(Gen::ZIPF, n, seed).generate();
+        case NEARLY_SORTED:
+            return Gen(Gen::NEARLY_SORTED, n, seed).generate();
+        case SAWTOOTH:
+            return Gen(Gen::SAWTOOTH, n, seed).generate();
+        }
+        return {};
+    }
+
+    /* Checks if an algorithm takes O(n²) time when run straight through.
+       SortEngine::isQuadratic() also counts the merge sorts, whose MOVE
+       events are quadratic to replay step by step; untraced here they are
+       O(n log n) and so run at every size. */
+    bool isQuadraticTime(SortEngine::Algorithm a)
+    {
+        return a == SortEngine::BUBBLE || a == SortEngine::INSERTION || a == SortEngine::SELECTION
+            || a == SortEngine::ODD_EVEN;
+    }
+
+    /* Writes one result object; stats is null for the uninstrumented
+       baselines, cacheMisses is only known when the cache was modelled */
+    void printResult(FILE* out, bool& first, const char* algorithm, Shape shape, size_t n,
+                     double seconds, const SortEngine::Stats* stats, bool cacheModelled,
+                     bool sorted)
+    {
+        std::fprintf(out, "%s\n    {\"algorithm\": \"%s\", \"shape\": \"%s\", \"size\": %zu, "
+                          "\"seconds\": %.9f, ",
+                     first ? "" : ",", algorithm, shapeName(shape), n, seconds);
+        if (stats)
+            std::fprintf(out, "\"comparisons\": %llu, \"swaps\": %llu, \"moves\": %llu, "
+                              "\"reads\": %llu, \"writes\": %llu, ",
+                         (unsigned long long)stats->comparisons,
+                         (unsigned long long)stats->swaps,
+                         (unsigned long long)stats->moves,
+                         (unsigned long long)stats->reads,
+                         (unsigned long long)stats->writes);
+        else
+            std::fprintf(out, "\"comparisons\": null, \"swaps\": null, \"moves\": null, "
+                              "\"reads\": null, \"writes\": null, ");
+        if (stats && cacheModelled)
+            std::fprintf(out, "\"cacheMisses\": %llu, ", (unsigned long long)stats->cacheMisses);
+        else
+            std::fprintf(out, "\"cacheMisses\": null, ");
+        std::fprintf(out, "\"sorted\": %s}", sorted ? "true" : "false");
+        std::fflush(out);
+        first = false;
+    }
+
+    /* Times a baseline sort of a copy of input */
+    template <typename Sort>
+    void runBaseline(FILE* out, bool& first, bool& allSorted, const char* algorithm,
+                     Shape shape, const std::vector<int>& input, Sort sort)
+    {
+        std::vector<int> keys = input;
+        const auto start = std::chrono::steady_clock::now();
+        sort(keys);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const bool sorted = std::is_sorted(keys.begin(), keys.end());
+        allSorted = allSorted && sorted;
+        printResult(out, first, algorithm, shape, input.size(), elapsed.count(), nullptr, false,
+                    sorted);
+    }
+
+    struct Options {
+        size_t minSize = 10;
+        size_t maxSize = 10000000;
+        size_t quadraticLimit = 10000;  // O(n²) algorithms skip larger inputs
+        uint32_t seed = 42;
+        bool cacheModel = false;        // Simulate a cache; slows the counted runs
+        const char* output = nullptr;   // stdout when null
+    };
+
+    void usage(const char* argv0)
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--min-size N] [--max-size N] [--quadratic-limit N]\n"
+                     "          [--seed S] [--cache-model] [--output FILE]\n"
+                     "Sizes run in powers of ten from min-size to max-size.\n"
+                     "--cache-model counts the misses of a simulated L1 data cache;\n"
+                     "the timings then include the simulation.\n",
+                     argv0);
+    }
+
+    bool parse(int argc, char* argv[], Options& opt)
+    {
+        for (int i = 1; i < argc; ++i) {
+            const char* arg = argv[i];
+            if (!std::strcmp(arg, "--cache-model")) {
+                opt.cacheModel = true;
+                continue;
+            }
+            const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+            if (!value)
+                return false;
+            if (!std::strcmp(arg, "--min-size"))             opt.minSize = std::strtoull(value, nullptr, 10);
+            else if (!std::strcmp(arg, "--max-size"))        opt.maxSize = std::strtoull(value, nullptr, 10);
+            else if (!std::strcmp(arg, "--quadratic-limit")) opt.quadraticLimit = std::strtoull(value, nullptr, 10);
+            else if (!std::strcmp(arg, "--seed"))            opt.seed = uint32_t(std::strtoul(value, nullptr, 10));
+            else if (!std::strcmp(arg, "--output"))          opt.output = value;
+            else return false;
+            ++i;
+        }
+        return opt.minSize > 0 && opt.minSize <= opt.maxSize;
+    }
+}
+
+/**
+ * Main entry point of the benchmark
+ *
+ * @param argc Argument count
+ * @param argv Argument values
+ * @return 0 on success, 1 on bad arguments, 2 if an algorithm failed to sort
+ */
+int main(int argc, char* argv[])
+{
+    Options opt;
+    if (!parse(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE* out = opt.output ? std::fopen(opt.output, "w") : stdout;
+    if (!out) {
+        std::perror(opt.output);
+        return 1;
+    }
+
+    std::fprintf(out, "{\n  \"seed\": %u,\n  \"workers\": %u,\n  \"results\": [",
+                 opt.seed, WorkStealingPool::shared().size());
+
+    bool first = true;
+    bool allSorted = true;
+    for (size_t n = opt.minSize; n <= opt.maxSize; n *= 10) {
+        for (Shape shape : kShapes) {
+            const std::vector<int> input = generate(shape, n, opt.seed);
+
+            for (int i = 0; i < SortEngine::kAlgorithmCount; ++i) {
+                const auto algorithm = static_cast<SortEngine::Algorithm>(i);
+                if (isQuadraticTime(algorithm) && n > opt.quadraticLimit)
+                    continue;
+
+                std::vector<int> keys = input;
+                CacheModel cache;
+                const auto start = std::chrono::steady_clock::now();
+                const SortEngine::Stats stats =
+                    SortEngine::run(algorithm, keys, nullptr, opt.cacheModel ? &cache : nullptr);
+                const std::chrono::duration<double> elapsed =
+                    std::chrono::steady_clock::now() - start;
+
+                const bool sorted = std::is_sorted(keys.begin(), keys.end());
+                allSorted = allSorted && sorted;
+                printResult(out, first, SortEngine::name(algorithm), shape, n,
+                            elapsed.count(), &stats, opt.cacheModel, sorted);
+            }
+
+            runBaseline(out, first, allSorted, "std::sort", shape, input,
+                        [](std::vector<int>& k) { std::sort(k.begin(), k.end()); });
+
+            for (int i = SimdSort::SCALAR; i <= SimdSort::bestIsa(); ++i) {
+                const auto isa = static_cast<SimdSort::Isa>(i);
+                const std::string name = std::string("SIMD Sort (") + SimdSort::name(isa) + ")";
+                runBaseline(out, first, allSorted, name.c_str(), shape, input,
+                            [isa](std::vector<int>& k) { SimdSort::sort(k.data(), k.size(), isa); });
+            }
+        }
+        if (n > opt.maxSize / 10)
+            break;
+    }
+
+    std::fprintf(out, "\n  ]\n}\n");
+    if (out != stdout)
+        std::fclose(out);
+
+    return allSorted ? 0 : 2;
+}
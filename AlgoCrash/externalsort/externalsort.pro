@@ -0,0 +1,27 @@
+# Out-of-core sort of int32 files or generated datasets (no Qt, no Box2D).
+# Build:  qmake externalsort.pro && make
+# Run:    ./AlgoCrashExternalSort --input keys.i32 --output sorted.i32 --memory 512
+
+QT      -=  core gui
+CONFIG  +=  console c++20 thread
+CONFIG  -=  app_bundle qt
+
+TEMPLATE = app
+TARGET = AlgoCrashExternalSort
+
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+INCLUDEPATH += ../include
+
+SOURCES += \
+    main.cpp \
+    ../src/datasetgenerator.cpp \
+    ../src/externalsort.cpp \
+    ../src/mappedfile.cpp \
+    ../src/simdsort.cpp
+
+HEADERS += \
+    ../include/datasetgenerator.h \
+    ../include/externalsort.h \
+    ../include/mappedfile.h \
+    ../include/simdsort.h
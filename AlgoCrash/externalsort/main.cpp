@@ -0,0 +1,125 @@
+/**
+ * externalsort/main.cpp
+ *
+ * This file contains the entry point of the command-line external sort. It
+ * sorts a file of int32 keys, or a generated dataset, into an output file
+ * using a fixed memory budget and reports every run and merge as it
+ * happens.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "datasetgenerator.h"
+#include "externalsort.h"
+
+namespace {
+    struct Options {
+        const char* input = nullptr;        // int32 file to sort
+        const char* generate = nullptr;     // Or a DatasetGenerator distribution
+        uint64_t count = 0;                 // Keys to generate
+        uint64_t seed = 42;
+        const char* output = nullptr;
+        ExternalSort::Options sort;
+    };
+
+    void usage(const char* argv0)
+    {
+        std::fprintf(stderr,
+                     "Usage: %s (--input FILE | --generate DISTRIBUTION --count N [--seed S])\n"
+                     "          --output FILE [--memory MB] [--fan-in K] [--temp-dir DIR]\n"
+                     "Files hold native-endian int32 keys. Distributions:",
+                     argv0);
+        for (int i = 0; i < DatasetGenerator::kDistributionCount; ++i)
+            std::fprintf(stderr, " %s",
+                         DatasetGenerator::name(static_cast<DatasetGenerator::Distribution>(i)));
+        std::fprintf(stderr, "\n");
+    }
+
+    bool parse(int argc, char* argv[], Options& opt)
+    {
+        for (int i = 1; i < argc; ++i) {
+            const char* arg = argv[i];
+            const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+            if (!value)
+                return false;
+            if (!std::strcmp(arg, "--input"))           opt.input = value;
+            else if (!std::strcmp(arg, "--generate"))   opt.generate = value;
+            else if (!std::strcmp(arg, "--count"))      opt.count = std::strtoull(value, nullptr, 10);
+            else if (!std::strcmp(arg, "--seed"))       opt.seed = std::strtoull(value, nullptr, 10);
+            else if (!std::strcmp(arg, "--output"))     opt.output = value;
+            else if (!std::strcmp(arg, "--memory"))     opt.sort.memoryBytes = size_t(std::strtoull(value, nullptr, 10)) << 20;
+            else if (!std::strcmp(arg, "--fan-in"))     opt.sort.fanIn = size_t(std::strtoull(value, nullptr, 10));
+            else if (!std::strcmp(arg, "--temp-dir"))   opt.sort.tempDir = value;
+            else return false;
+            ++i;
+        }
+        return opt.output && (opt.input != nullptr) != (opt.generate != nullptr)
+               && (!opt.generate || opt.count > 0);
+    }
+
+    bool distribution(const char* name, DatasetGenerator::Distribution& d)
+    {
+        for (int i = 0; i < DatasetGenerator::kDistributionCount; ++i) {
+            d = static_cast<DatasetGenerator::Distribution>(i);
+            if (!std::strcmp(name, DatasetGenerator::name(d)))
+                return true;
+        }
+        return false;
+    }
+
+    void report(const ExternalSort::Event& e)
+    {
+        switch (e.kind) {
+        case ExternalSort::Event::RUN_WRITTEN:
+            std::fprintf(stderr, "run %u: %llu keys\n", e.run, (unsigned long long)e.keys);
+            break;
+        case ExternalSort::Event::MERGE_STARTED:
+            std::fprintf(stderr, "pass %u: merging %zu runs into %s %u (%llu keys)\n", e.pass,
+                         e.inputs.size(), e.final ? "output" : "run", e.run,
+                         (unsigned long long)e.keys);
+            break;
+        case ExternalSort::Event::MERGE_FINISHED:
+            break;
+        }
+    }
+}
+
+/**
+ * Main entry point of the external sort
+ *
+ * @param argc Argument count
+ * @param argv Argument values
+ * @return 0 on success, 1 on bad arguments, 2 if the sort failed
+ */
+int main(int argc, char* argv[])
+{
+    Options opt;
+    DatasetGenerator::Distribution d = DatasetGenerator::UNIFORM;
+    if (!parse(argc, argv, opt) || (opt.generate && !distribution(opt.generate, d))) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    ExternalSort::Result result;
+    if (opt.input) {
+        result = ExternalSort::sortFile(opt.input, opt.output, opt.sort, report);
+    } else {
+        const DatasetGenerator generator(d, opt.count, opt.seed);
+        uint64_t position = 0;
+        const auto source = [&generator, &position](int* out, size_t max) {
+            const size_t n = generator.fill(position, out, max);
+            position += n;
+            return n;
+        };
+        result = ExternalSort::sort(source, opt.output, opt.sort, report);
+    }
+
+    if (!result.error.empty()) {
+        std::fprintf(stderr, "error: %s\n", result.error.c_str());
+        return 2;
+    }
+    std::printf("{\"keys\": %llu, \"runs\": %u, \"passes\": %u, \"seconds\": %.6f}\n",
+                (unsigned long long)result.keys, result.runs, result.passes, result.seconds);
+    return 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * arrayviewitem.h
+ *
+ * This file defines the ArrayViewItem class which draws arrays too large for
+ * physics blocks at a level of detail that suits the zoom.
+ */
+#ifndef ARRAYVIEWITEM_H
+#define ARRAYVIEWITEM_H
+
+#include <QGraphicsItem>
+#include <QPainter>
+#include <cstdint>
+#include <vector>
+
+class SortingController;
+
+/**
+ * ArrayViewItem
+ *
+ * Shows the array a headless SortingController is sorting. The item keeps
+ * a window of visible indices; the wheel zooms it around the cursor, a
+ * drag pans it and a double click shows the whole array again. Only the
+ * window is read and drawn, in one of three levels of detail chosen from
+ * how many device pixels an element gets:
+ *
+ *  - blocks: a labelled square per element, like the physics scene
+ *  - bars:   a value-height bar per element, batched by colour
+ *  - columns: a min/max line per pixel column over the elements it covers
+ *
+ * The last level caps drawing at one primitive per pixel column however
+ * many elements there are, so the cost of a frame follows the view size.
+ * Columns are only recomputed when the sort or the window moved.
+ */
+class ArrayViewItem : public QGraphicsItem
+{
+public:
+    /**
+     * Creates the view
+     *
+     * @param controller The controller whose array is shown
+     * @param area       Scene rect the array is drawn into
+     */
+    ArrayViewItem(const SortingController& controller, const QRectF& area);
+
+    /**
+     * Takes up a new array: measures its value range and shows all of it
+     */
+    void reset();
+
+    /**
+     * Schedules a repaint if the sort moved since the last paint
+     */
+    void refresh();
+
+    QRectF boundingRect() const override { return m_area; }
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
+               QWidget* widget = nullptr) override;
+
+protected:
+    void wheelEvent(QGraphicsSceneWheelEvent* event) override;
+    void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
+    void mouseMoveEvent(QGraphicsSceneMouseEvent* event) override;
+    void mouseDoubleClickEvent(QGraphicsSceneMouseEvent* event) override;
+
+private:
+    const SortingController& m_controller;
+    QRectF m_area;
+    double m_first = 0;             // Window start, in elements
+    double m_count = 0;             // Window length, in elements
+    int64_t m_min = 0;              // Value range of the array
+    int64_t m_max = 0;
+    size_t m_shownStep = 0;         // Sort step of the last paint
+    bool m_shownComplete = false;
+
+    // Column cache, valid while the step, window and width are unchanged
+    std::vector<QRectF> m_columns;
+    size_t m_columnsStep = SIZE_MAX;
+    double m_columnsFirst = -1;
+    double m_columnsCount = -1;
+    int m_columnsWidth = -1;
+
+    std::vector<QPainter::PixmapFragment> m_fragments;  // Labels, reused across paints
+
+    /**
+     * Gets the bar height of a value
+     *
+     * @param value The value
+     * @return Height in scene units, at least a hairline
+     */
+    qreal barHeight(int value) const;
+
+    /**
+     * Moves the window, keeping it within the array
+     *
+     * @param first Requested start
+     * @param count Requested length
+     */
+    void setWindow(double first, double count);
+
+    void paintBlocks(QPainter* painter, size_t first, size_t last, qreal slot);
+    void paintBars(QPainter* painter, size_t first, size_t last, qreal slot);
+    void paintColumns(QPainter* painter, int width);
+};
+
+#endif // ARRAYVIEWITEM_H
@@ -0,0 +1,83 @@
+/**
+ * blockarrayitem.h
+ *
+ * This file defines the BlockArrayItem class which draws a whole array of
+ * blocks as a single graphics item.
+ */
+#ifndef BLOCKARRAYITEM_H
+#define BLOCKARRAYITEM_H
+
+#include "replayfile.h"
+#include <QGraphicsItem>
+#include <QPainter>
+#include <QColor>
+#include <vector>
+
+class PhysicsBlock;
+
+/**
+ * BlockArrayItem
+ *
+ * A batched alternative to showing every PhysicsBlock as its own scene
+ * item. Each frame the blocks' transforms, colours and values are copied
+ * into one contiguous array, and a single paint() draws them all: upright
+ * blocks are grouped by colour and drawn with one drawRects() call per
+ * colour, tilted ones as polygons, and the digits of all labels in one
+ * LabelAtlas blit, skipped where they would be too small to read. The
+ * scene then indexes one item instead of two per block, which keeps
+ * thousands of blocks at frame rate.
+ *
+ * The PhysicsBlocks keep owning physics and state; they are just left out
+ * of the scene while this item draws for them.
+ */
+class BlockArrayItem : public QGraphicsItem
+{
+public:
+    /**
+     * Creates an empty array
+     */
+    BlockArrayItem();
+
+    /**
+     * Copies the current look of the blocks, to be drawn at the next paint.
+     * Only the area of blocks that changed is scheduled for repaint.
+     *
+     * @param blocks The blocks, already synced with physics
+     */
+    void sync(const std::vector<PhysicsBlock*>& blocks);
+
+    /**
+     * Copies a recorded frame, to be drawn at the next paint, the same way
+     * as the live blocks
+     *
+     * @param blocks The blocks of a ReplayReader frame
+     */
+    void sync(const std::vector<ReplayBlock>& blocks);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
+               QWidget* widget = nullptr) override;
+
+private:
+    /**
+     * What paint() needs of one block
+     */
+    struct Block {
+        QPointF pos;        // Centre in scene coordinates
+        qreal rotation;     // Degrees, as QGraphicsItem::rotation()
+        QRgb fill;
+        int value;
+    };
+
+    std::vector<Block> m_blocks;
+    std::vector<Block> m_incoming;      // Look being synced, reused across syncs
+    QRectF m_bounds;
+    std::vector<QPainter::PixmapFragment> m_fragments;  // Label digits, reused across paints
+
+    /**
+     * Takes m_incoming as the look to draw, scheduling repaints for changes
+     */
+    void commitIncoming();
+};
+
+#endif // BLOCKARRAYITEM_H
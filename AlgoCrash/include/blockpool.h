@@ -0,0 +1,74 @@
+/**
+ * blockpool.h
+ *
+ * This file defines the BlockPool class which recycles PhysicsBlocks
+ * between datasets.
+ */
+#ifndef BLOCKPOOL_H
+#define BLOCKPOOL_H
+
+#include <cstddef>
+#include <vector>
+
+class PhysicsBlock;
+class PhysicsWorld;
+
+/**
+ * BlockPool
+ *
+ * Keeps the blocks of a cleared scene instead of deleting them and hands
+ * them out again, with a fresh value and position, when the next dataset
+ * is spawned. Together with PhysicsWorld keeping destroyed bodies for
+ * reuse, a reset re-initialises items and bodies in place: no graphics
+ * items, bodies or fixtures are allocated or freed once the pool has seen
+ * a dataset as large as the current one.
+ *
+ * Released blocks must already be out of the scene; the pool deletes the
+ * ones it still holds when it is destroyed.
+ */
+class BlockPool
+{
+public:
+    /**
+     * Creates an empty pool
+     *
+     * @param world World the blocks' bodies live in
+     */
+    explicit BlockPool(PhysicsWorld* world);
+
+    /**
+     * Deletes the spare blocks
+     */
+    ~BlockPool();
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    /**
+     * Gets a block with a new body at world coordinates (x, y)
+     *
+     * @param x     Horizontal position in meters
+     * @param y     Vertical position in meters
+     * @param value The value shown on the block
+     * @return A spare block if there is one, else a new block
+     */
+    PhysicsBlock* acquire(float x, float y, int value);
+
+    /**
+     * Takes back a block that left the scene; its body is destroyed
+     *
+     * @param block The block, owned by the pool from now on
+     */
+    void release(PhysicsBlock* block);
+
+    /**
+     * Gets the number of spare blocks
+     */
+    size_t spareCount() const { return m_spare.size(); }
+
+private:
+    PhysicsWorld* m_world;
+    std::vector<PhysicsBlock*> m_spare;
+};
+
+#endif // BLOCKPOOL_H
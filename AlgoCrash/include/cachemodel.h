@@ -0,0 +1,48 @@
+/**
+ * cachemodel.h
+ *
+ * This file defines the CacheModel class, a small simulated data cache
+ * used to estimate the memory traffic of the sorting algorithms.
+ */
+#ifndef CACHEMODEL_H
+#define CACHEMODEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * CacheModel
+ *
+ * A set-associative cache with LRU replacement over the key array, sized
+ * like a typical L1 data cache (32 KiB, 64-byte lines, 8 ways). Accesses
+ * are given as element indices; every access that misses counts one cache
+ * line fetched from memory. The model is a plain value, so it can be
+ * copied into undo checkpoints.
+ */
+class CacheModel {
+public:
+    static constexpr size_t kLineBytes = 64;
+    static constexpr size_t kWays = 8;
+    static constexpr size_t kSets = 32 * 1024 / kLineBytes / kWays;
+
+    /**
+     * Touches the line holding one element
+     *
+     * @param index       Element index in the key array
+     * @param elementSize Size of one element in bytes
+     * @return True if the line was not cached (a miss)
+     */
+    bool access(size_t index, size_t elementSize = sizeof(int));
+
+    /**
+     * Empties the cache
+     */
+    void clear() { m_lines.fill(0); }
+
+private:
+    // Per set, line numbers + 1 from most to least recently used; 0 is empty
+    std::array<uint32_t, kSets * kWays> m_lines{};
+};
+
+#endif // CACHEMODEL_H
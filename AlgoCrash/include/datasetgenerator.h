@@ -0,0 +1,131 @@
+/**
+ * datasetgenerator.h
+ *
+ * This file defines the DatasetGenerator class which produces seeded,
+ * reproducible inputs for the sorting algorithms.
+ */
+#ifndef DATASETGENERATOR_H
+#define DATASETGENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * DatasetGenerator
+ *
+ * Describes a dataset by its distribution, size, seed and one shape
+ * parameter, and computes keys on demand. Every key is a pure function of
+ * the seed and its index (a counter-based generator), so keys never have
+ * to be stored: a run over billions of keys pulls them a chunk at a time,
+ * chunks can be produced in any order or in parallel, and the same seed
+ * always gives the same dataset.
+ *
+ * Values are ints; distributions that count up with the index (reversed,
+ * nearly sorted, sawtooth) divide the index down so that sizes beyond
+ * INT_MAX keep their order, with adjacent duplicates.
+ */
+class DatasetGenerator {
+public:
+    /**
+     * Shapes of generated input. The parameter given to the constructor
+     * means, for each, with the default used when it is 0:
+     */
+    enum Distribution {
+        UNIFORM,            //!< Values in [0, parameter); default count
+        GAUSSIAN,           //!< Mean count / 2, deviation parameter; default count / 6
+        ZIPF,               //!< Ranks 1..count with exponent parameter; default 1
+        NEARLY_SORTED,      //!< Ascending with parameter adjacent pairs swapped; default
+                            //!< count / 64, at least 1
+        REVERSED,           //!< Descending; no parameter
+        SAWTOOTH,           //!< Ascending runs of parameter keys; default sqrt(count)
+        MANY_DUPLICATES     //!< parameter distinct values; default sqrt(count), within [2, 8]
+    };
+
+    static constexpr int kDistributionCount = MANY_DUPLICATES + 1;
+    static constexpr size_t kChunkKeys = 64 * 1024;    //!< Keys per next() chunk
+
+    /**
+     * Gets the display name of a distribution
+     *
+     * @param d The distribution
+     * @return Its name, e.g. "nearly-sorted"
+     */
+    static const char* name(Distribution d);
+
+    /**
+     * Describes a dataset
+     *
+     * @param d         The distribution
+     * @param count     Number of keys
+     * @param seed      Seed; equal seeds give equal datasets
+     * @param parameter Shape parameter as listed in Distribution, 0 for
+     *                  its default
+     */
+    DatasetGenerator(Distribution d, uint64_t count, uint64_t seed, double parameter = 0);
+
+    /**
+     * Gets the number of keys
+     */
+    uint64_t size() const { return m_count; }
+
+    /**
+     * Computes one key
+     *
+     * @param index Key index, below size()
+     * @return The key
+     */
+    int at(uint64_t index) const;
+
+    /**
+     * Computes a range of keys
+     *
+     * @param first Index of the first key
+     * @param out   Receives the keys
+     * @param n     Number of keys wanted
+     * @return Number of keys written; fewer than n at the end of the dataset
+     */
+    size_t fill(uint64_t first, int* out, size_t n) const;
+
+    /**
+     * Computes the next chunk of keys, continuing where the last call
+     * stopped
+     *
+     * @param chunk Receives up to kChunkKeys keys, reusing its storage
+     * @return Number of keys in chunk; 0 once the dataset is exhausted
+     */
+    size_t next(std::vector<int>& chunk);
+
+    /**
+     * Makes next() start again from the first key
+     */
+    void rewind() { m_position = 0; }
+
+    /**
+     * Computes the whole dataset; only sensible for sizes that fit in memory
+     *
+     * @return All keys
+     */
+    std::vector<int> generate() const;
+
+private:
+    Distribution m_distribution;
+    uint64_t m_count;
+    uint64_t m_key;             // Mixed seed
+    double m_parameter;
+    unsigned m_shift = 0;       // Index bits dropped so ramps fit in an int
+    uint64_t m_position = 0;    // Next index for next()
+
+    // Zipf rejection-inversion constants
+    double m_hIntegralX1 = 0;
+    double m_hIntegralN = 0;
+    double m_s = 0;
+
+    uint64_t draw(uint64_t index, uint64_t stream) const;
+    double uniform(uint64_t index, uint64_t stream) const;
+    int ramp(uint64_t index) const;
+    uint64_t permute(uint64_t x, uint64_t domain) const;
+    int zipf(uint64_t index) const;
+};
+
+#endif // DATASETGENERATOR_H
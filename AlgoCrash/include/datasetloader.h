@@ -0,0 +1,103 @@
+/**
+ * datasetloader.h
+ *
+ * This file defines the DatasetLoader class which reads keys to sort from
+ * text and raw binary files.
+ */
+#ifndef DATASETLOADER_H
+#define DATASETLOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "workstealingpool.h"
+
+/**
+ * DatasetLoader
+ *
+ * Loads integer keys from a file without copying it: the file is memory
+ * mapped and split into chunks at token boundaries, and every chunk is
+ * parsed by its own pool job straight out of the mapping. Text files hold
+ * decimal integers separated by commas, semicolons or whitespace (so both
+ * one-per-line and CSV files work); binary files hold native-endian int32
+ * or int64 values back to back.
+ *
+ * Bad tokens are counted rather than collected: only the first few are
+ * kept, with their byte offsets, so a broken multi-gigabyte file still
+ * produces a short report.
+ */
+class DatasetLoader {
+public:
+    /**
+     * How the file contents are encoded
+     */
+    enum Format {
+        TEXT,       //!< Decimal integers separated by , ; or whitespace
+        INT32,      //!< Raw native-endian 32-bit integers
+        INT64       //!< Raw native-endian 64-bit integers
+    };
+
+    static constexpr size_t kMaxSamples = 8;    //!< Bad tokens kept for the report
+
+    /**
+     * A token that could not be loaded
+     */
+    struct Sample {
+        uint64_t offset;            // Byte offset in the file
+        std::string token;          // The token text, shortened if long
+    };
+
+    /**
+     * Outcome of a load
+     */
+    struct Result {
+        std::vector<int> keys;      // The valid keys in file order
+        uint64_t invalid = 0;       // Tokens that are not integers
+        uint64_t outOfRange = 0;    // Integers that do not fit in an int
+        std::vector<Sample> samples;    // The first bad tokens, at most kMaxSamples
+        std::string error;          // Why nothing could be read; empty on success
+
+        /**
+         * Describes the skipped tokens in a few lines
+         *
+         * @return The counts and the sampled tokens, or an empty string
+         *         if every token was loaded
+         */
+        std::string summary() const;
+    };
+
+    /**
+     * Guesses the format from a file name: .i32 and .bin are INT32,
+     * .i64 is INT64 and anything else is TEXT
+     *
+     * @param path The file name
+     * @return The format
+     */
+    static Format formatFor(const std::string& path);
+
+    /**
+     * Loads a file
+     *
+     * @param path   The file to read
+     * @param format How its contents are encoded
+     * @param pool   The pool to parse on
+     * @return The keys and the report of skipped tokens
+     */
+    static Result load(const std::string& path, Format format,
+                       WorkStealingPool& pool = WorkStealingPool::shared());
+
+    /**
+     * Parses keys held in memory
+     *
+     * @param data   The encoded keys
+     * @param size   Size of data in bytes
+     * @param format How data is encoded
+     * @param pool   The pool to parse on
+     * @return The keys and the report of skipped tokens
+     */
+    static Result parse(const char* data, size_t size, Format format,
+                        WorkStealingPool& pool = WorkStealingPool::shared());
+};
+
+#endif // DATASETLOADER_H
@@ -0,0 +1,112 @@
+/**
+ * externalsort.h
+ *
+ * This file defines the ExternalSort class which sorts inputs larger than
+ * memory through temporary run files.
+ */
+#ifndef EXTERNALSORT_H
+#define EXTERNALSORT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * ExternalSort
+ *
+ * An out-of-core merge sort over files of native-endian int32 keys (the
+ * DatasetLoader INT32 format). The input is read in pieces that fit the
+ * memory budget; every piece is sorted in memory and spilled to a
+ * temporary file as a sorted run, the next piece being sorted while the
+ * previous run is still being written. Runs are then merged up to fanIn
+ * at a time with a loser tree, pass after pass, until one run is left,
+ * which is the output.
+ *
+ * Disk I/O runs on background threads and is double-buffered: every run
+ * being merged has a second buffer that is filled while the first is
+ * consumed, and the output is written from one buffer while the merge
+ * fills the other.
+ */
+class ExternalSort {
+public:
+    /**
+     * Memory and file settings
+     */
+    struct Options {
+        size_t memoryBytes = size_t(256) << 20;  // Budget for run formation (two run buffers)
+        size_t fanIn = 64;                  // Most runs merged at once; at least 2
+        size_t bufferKeys = 64 * 1024;      // Keys per I/O buffer while merging
+        std::string tempDir;                // Where runs are spilled; empty for the system default
+        const std::atomic<bool>* cancel = nullptr;  // Set to stop the sort early, may be null
+    };
+
+    /**
+     * Something that happened to a run, reported as it happens
+     */
+    struct Event {
+        enum Kind {
+            RUN_WRITTEN,        //!< A sorted run was spilled during run formation
+            MERGE_STARTED,      //!< inputs are being merged into run
+            MERGE_FINISHED      //!< run is complete and inputs are deleted
+        };
+        Kind kind;
+        unsigned pass;                  // 0 for run formation, then merge passes from 1
+        uint32_t run;                   // The run written or produced
+        uint64_t keys;                  // Keys in run
+        std::vector<uint32_t> inputs;   // Runs merged into run
+        bool final;                     // True if run is the output file
+    };
+
+    /**
+     * Receives events on the sorting thread
+     */
+    using Observer = std::function<void(const Event&)>;
+
+    /**
+     * Produces the input in pieces
+     *
+     * Writes up to max keys to out and returns how many it wrote; 0 ends
+     * the input
+     */
+    using Source = std::function<size_t(int* out, size_t max)>;
+
+    /**
+     * Outcome of a sort
+     */
+    struct Result {
+        uint64_t keys = 0;          // Keys sorted
+        uint32_t runs = 0;          // Runs written during run formation
+        unsigned passes = 0;        // Merge passes over the data
+        double seconds = 0;         // Wall time
+        std::string error;          // Why the sort failed; empty on success
+    };
+
+    /**
+     * Sorts a file of int32 keys into another file
+     *
+     * @param input    The file to sort; it is memory mapped, not loaded
+     * @param output   The file to write; replaced if it exists
+     * @param options  Memory and file settings
+     * @param observer Called for every run event, may be empty
+     * @return The counts, or the error that stopped the sort
+     */
+    static Result sortFile(const std::string& input, const std::string& output,
+                           const Options& options, const Observer& observer = {});
+
+    /**
+     * Sorts the keys a source produces into a file
+     *
+     * @param source   Produces the keys, e.g. from a DatasetGenerator
+     * @param output   The file to write; replaced if it exists
+     * @param options  Memory and file settings
+     * @param observer Called for every run event, may be empty
+     * @return The counts, or the error that stopped the sort
+     */
+    static Result sort(const Source& source, const std::string& output,
+                       const Options& options, const Observer& observer = {});
+};
+
+#endif // EXTERNALSORT_H
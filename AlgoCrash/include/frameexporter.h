@@ -0,0 +1,118 @@
+/**
+ * frameexporter.h
+ *
+ * This file defines the FrameExporter class, which writes rendered frames
+ * to disk as an image sequence or a raw video stream, encoding them on
+ * the shared WorkStealingPool.
+ */
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include <QImage>
+#include <QString>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/**
+ * FrameExporter
+ *
+ * Frames handed to addFrame() are queued, and a feeder thread takes the
+ * whole queue at a time and encodes it as one batch on
+ * WorkStealingPool::shared(), one job per frame, while the caller renders
+ * the next ones. At most kMaxQueued frames wait, so a caller that renders
+ * faster than the pool encodes is held back rather than filling memory.
+ *
+ * PNG_SEQUENCE writes each frame to its own PNG file next to the chosen
+ * path, numbered from 0 (run.png gives run_000000.png, run_000001.png,
+ * ...). RAW_VIDEO writes one file of headerless 8-bit RGB frames, in
+ * order, as read by e.g. ffmpeg -f rawvideo -pix_fmt rgb24.
+ */
+class FrameExporter {
+public:
+    enum Format { PNG_SEQUENCE, RAW_VIDEO };
+
+    static constexpr size_t kMaxQueued = 16;
+
+    /**
+     * Starts an export; check error() for failures
+     *
+     * @param path   The raw video file, or the pattern of the PNG files
+     * @param format How to write the frames
+     */
+    FrameExporter(const QString& path, Format format);
+
+    /**
+     * Finishes the export if finish() was not called
+     */
+    ~FrameExporter();
+
+    FrameExporter(const FrameExporter&) = delete;
+    FrameExporter& operator=(const FrameExporter&) = delete;
+
+    /**
+     * Queues a frame for encoding, waiting while kMaxQueued frames do
+     *
+     * @param frame The frame; every frame should have the same size
+     */
+    void addFrame(QImage frame);
+
+    /**
+     * Encodes the frames still queued and closes the output
+     *
+     * @return False if writing any frame failed; see error()
+     */
+    bool finish();
+
+    /**
+     * Gets the number of frames added
+     */
+    uint64_t frames() const { return m_added; }
+
+    /**
+     * Gets why the export failed
+     *
+     * @return The reason, or an empty string while all is well
+     */
+    QString error() const;
+
+    /**
+     * Gets the file a frame of a PNG sequence is written to
+     *
+     * @param path  The path the export was started with
+     * @param frame The frame number
+     * @return The frame's file
+     */
+    static QString framePath(const QString& path, uint64_t frame);
+
+private:
+    QString m_path;
+    Format m_format;
+    std::FILE* m_raw = nullptr;         // The RAW_VIDEO output
+    uint64_t m_added = 0;               // Caller side only
+
+    std::thread m_feeder;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::deque<QImage> m_queue;         // Frames not yet taken by the feeder
+    uint64_t m_nextFrame = 0;           // Number of the queue's first frame
+    bool m_closing = false;
+    QString m_error;
+
+    /**
+     * Body of the feeder thread: encodes batches until closed and drained
+     */
+    void feed();
+
+    /**
+     * Fails the export unless it failed already
+     *
+     * @param reason Why it failed
+     */
+    void fail(const QString& reason);
+};
+
+#endif // FRAMEEXPORTER_H
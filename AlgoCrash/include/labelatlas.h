@@ -0,0 +1,84 @@
+/**
+ * labelatlas.h
+ *
+ * This file defines the LabelAtlas class which draws block values from
+ * pre-rendered digits.
+ */
+#ifndef LABELATLAS_H
+#define LABELATLAS_H
+
+#include <QFont>
+#include <QPainter>
+#include <QPixmap>
+#include <QRectF>
+#include <vector>
+
+/**
+ * LabelAtlas
+ *
+ * The digits and the minus sign, rasterized once in the block label font
+ * into one pixmap. A label is then a blit per digit instead of shaping and
+ * rasterizing text on every repaint. Labels are appended as pixmap
+ * fragments, so a caller drawing many blocks can issue all of their digits
+ * in a single drawPixmapFragments() call.
+ *
+ * Must be used from the GUI thread only.
+ */
+class LabelAtlas
+{
+public:
+    /**
+     * Gets the atlas for the block label font, built on first use
+     *
+     * @return The shared atlas
+     */
+    static LabelAtlas& shared();
+
+    /**
+     * Appends the fragments that draw a value centred on a point
+     *
+     * @param out      Receives one fragment per character
+     * @param centre   Centre of the label in painter coordinates
+     * @param value    The value to show
+     * @param rotation Rotation of the label around centre, in degrees
+     * @param scale    Size relative to a label on an 80 px block
+     */
+    void append(std::vector<QPainter::PixmapFragment>& out, const QPointF& centre,
+                int value, qreal rotation = 0, qreal scale = 1) const;
+
+    /**
+     * Gets the width a value's label takes at scale 1
+     *
+     * @param value The value
+     * @return Width in logical pixels
+     */
+    qreal width(int value) const;
+
+    /**
+     * Draws fragments built by append()
+     *
+     * @param painter   The painter
+     * @param fragments The fragments
+     */
+    void draw(QPainter* painter, const std::vector<QPainter::PixmapFragment>& fragments) const;
+
+    /**
+     * Draws one value centred on a point
+     *
+     * @param painter The painter
+     * @param centre  Centre of the label in painter coordinates
+     * @param value   The value to show
+     */
+    void draw(QPainter* painter, const QPointF& centre, int value) const;
+
+private:
+    static constexpr int kGlyphs = 11;  // Digits 0-9, then '-'
+
+    explicit LabelAtlas(const QFont& font);
+
+    QPixmap m_pixmap;
+    QRectF m_cells[kGlyphs];        // Source rects, in pixmap pixels
+    qreal m_advance[kGlyphs];       // Pen advance, in logical pixels
+};
+
+#endif // LABELATLAS_H
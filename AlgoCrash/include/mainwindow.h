@@ -13,11 +13,22 @@
 #include <QGraphicsScene>
 #include <QTimer>
 #include <vector>
-#include <Box2D/Box2D.h>
+#include "arrayviewitem.h"
+#include "blockarrayitem.h"
+#include "blockpool.h"
+#include "datasetgenerator.h"
+#include "datasetloader.h"
+#include "externalsort.h"
 #include "physicsblock.h"
+#include "physicsworld.h"
+#include "replayfile.h"
 #include "sortingcontroller.h"
 #include <QLabel>
 #include <random>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -32,7 +43,8 @@ QT_END_NAMESPACE
  *  * Runs a 60 FPS timer to step the Box2D world and update graphics.
  *  * Owns a second timer that drives the @ref SortingController at a user‑set
  *    pace (via a speed slider).
- *  * Responds to UI buttons: *Step*, *Start/Pause*, *Reset*, *Customize*.
+ *  * Responds to UI buttons: *Step*, *Start/Pause*, *Reset*, *Customize*,
+ *    and to the timeline slider, which jumps to any step of the sort.
  */
 class MainWindow : public QMainWindow
 {
@@ -58,6 +70,15 @@ protected:
      */
     void resizeEvent(QResizeEvent* event) override;
 
+    /**
+     * Zooms the block scene with the mouse wheel
+     *
+     * @param watched The graphics view's viewport
+     * @param event   The event
+     * @return True if the event was a zoom
+     */
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
 private slots:
     /**
      * Handles Step button clicks to advance the sorting algorithm one step
@@ -78,8 +99,47 @@ private slots:
      * Handles Customize button clicks to allow custom data input
      */
     void onCustomizeButtonClicked();
+
+    /**
+     * Handles Load File button clicks to read keys from a text or binary file
+     */
+    void onLoadFileButtonClicked();
+
+    /**
+     * Handles External Sort button clicks: sorts an int32 file through
+     * temporary runs on a background thread, showing one block per run
+     */
+    void onExternalSortButtonClicked();
+
+    /**
+     * Handles Export Frames button clicks: runs the rest of the sort with
+     * physics stepped as fast as frames can be rendered offscreen, and
+     * writes them as PNG files or a raw video stream
+     */
+    void onExportButtonClicked();
     void onStepBackwardButtonClicked();
 
+    /**
+     * Handles timeline slider changes by jumping the sort to that step
+     *
+     * @param value The step selected on the slider
+     */
+    void onTimelineValueChanged(int value);
+
+    /**
+     * Starts or finishes recording the blocks into a replay file chosen by
+     * the user
+     *
+     * @param record True to start recording
+     */
+    void onRecordToggled(bool record);
+
+    /**
+     * Handles Play Replay button clicks: plays a replay file in place of
+     * the blocks, or stops the replay being played
+     */
+    void onReplayButtonClicked();
+
 
 private:
     Ui::MainWindow *ui;
@@ -87,9 +147,23 @@ private:
     QGraphicsScene* scene;
     QTimer* simTimer;                   //!< 60 FPS physics loop
     QTimer* sortTimer;                  //!< Drives SortingController
-    b2World* world;
+    PhysicsWorld* world;                //!< Block physics, maybe on its own thread
+    BlockPool* m_blockPool;             //!< Blocks of cleared scenes, for reuse
 
     std::vector<PhysicsBlock*> blocks;  //!< Active tiles
+    std::vector<PhysicsBlock*> m_blockOfBody;   //!< Shown blocks by body id
+    std::vector<uint8_t> m_spawnState;  //!< World as the blocks were spawned
+    std::vector<int> m_spawnValues;     //!< Values of the spawned blocks
+    BlockArrayItem* m_blockArray = nullptr; //!< Draws all blocks when batched
+    bool m_batched = false;             //!< Blocks are drawn by m_blockArray
+    ArrayViewItem* m_arrayView = nullptr;   //!< Draws headless arrays
+    bool m_arrayMode = false;           //!< Sorting keys without blocks
+    bool m_stepDeferred = false;        //!< A sort tick waits for an animation
+    bool m_timelineKnown = true;        //!< The timeline shows the run's length
+    std::unique_ptr<ReplayWriter> m_recorder;   //!< Records frames while Record is on
+    std::unique_ptr<ReplayReader> m_replay;     //!< Replay being played, if any
+    double m_replayPosition = 0.0;      //!< Frame of m_replay shown, fractional
+    std::vector<ReplayBlock> m_replayFrame;     //!< Frame being recorded or shown
     SortingController sortController;   //!< Algorithm driver
 
     /**
@@ -99,11 +173,179 @@ private:
      */
     void spawnInitialBlocks(const std::vector<int>& values);
 
+    /**
+     * Gets the keys of the dataset selected in the UI
+     *
+     * @return The example keys, or the generated dataset for the selected
+     *         distribution and seed
+     */
+    std::vector<int> datasetValues() const;
+
+    /**
+     * Replaces whatever is being sorted: as blocks, batched blocks beyond
+     * kMaxBlocks, or a headless array in the ArrayViewItem beyond
+     * kMaxBatchedBlocks
+     *
+     * @param values The values to sort
+     */
+    void showValues(std::vector<int> values);
+
+    /**
+     * Switches between blocks and the headless array view
+     *
+     * @param array True for the array view
+     */
+    void setArrayMode(bool array);
+
+    /**
+     * Sizes the scene to what is shown and fits the view to it
+     */
+    void fitScene();
+
+    /**
+     * Gets the most values the current algorithm may be given
+     *
+     * @return The cap, lower for quadratic and parallel algorithms
+     */
+    size_t maxValues() const;
+
+    /**
+     * Trims the headless array before switching to a quadratic or parallel
+     * algorithm
+     *
+     * @param algorithm The algorithm about to be selected
+     */
+    void capArrayFor(SortingController::Algorithm algorithm);
+
+    /**
+     * Appends the look of the blocks to the replay being recorded
+     */
+    void recordFrame();
+
+    /**
+     * Shows the replay frame at m_replayPosition through m_blockArray
+     */
+    void showReplayFrame();
+
+    /**
+     * Stops playing a replay, leaving the scene empty for the caller to fill
+     */
+    void closeReplay();
+
+    /**
+     * Removes every block from the scene and the physics world
+     */
+    void clearBlocks();
+
+    /**
+     * Shows a new block, as its own scene item unless rendering is batched,
+     * and syncs it with its body from now on
+     *
+     * @param block The block
+     */
+    void addBlockItem(PhysicsBlock* block);
+
+    /**
+     * Stops showing and syncing a block, taking it out of the scene if it
+     * is in it
+     *
+     * @param block The block
+     */
+    void removeBlockItem(PhysicsBlock* block);
+
+    /**
+     * Syncs the blocks whose bodies the current snapshot lists as changed
+     */
+    void syncChangedBlocks();
+
+    /**
+     * Switches between one scene item per block and a single BlockArrayItem
+     * drawing them all
+     *
+     * @param batched True to draw through the BlockArrayItem
+     */
+    void setBatchedRendering(bool batched);
+
+    /**
+     * Chooses between repainting only what changed and repainting the
+     * whole view every frame
+     *
+     * @param partial True to repaint only the changed area
+     */
+    void setPartialRepaint(bool partial);
+
+    /**
+     * Shows a run event of the external sort: runs appear as blocks and
+     * merged runs are replaced by the run they were merged into
+     *
+     * @param e The event, delivered on the GUI thread
+     */
+    void onExternalSortEvent(const ExternalSort::Event& e);
+
+    /**
+     * Reports the outcome of the external sort and unlocks the UI
+     *
+     * @param result The outcome
+     * @param output The file that was written
+     */
+    void onExternalSortFinished(const ExternalSort::Result& result, const QString& output);
+
+    /**
+     * Locks the controls that would disturb a running external sort
+     *
+     * @param running True while the external sort runs
+     */
+    void setExternalSortRunning(bool running);
+
+    /**
+     * Replaces the blocks with loaded keys, summarizing any skipped tokens
+     *
+     * @param result  The loaded keys; trimmed to the number of blocks shown
+     * @param message The status text to show once the blocks are spawned
+     */
+    void loadValues(DatasetLoader::Result& result, const QString& message);
+
     /**
      * Updates the statistics display (comparisons and swaps)
      */
     void updateStatistics();
 
+    /**
+     * Moves the timeline slider to the controller's current step
+     */
+    void updateTimeline();
+
+    /**
+     * Sets the sort timer interval from the speed slider, or to one frame
+     * in turbo mode
+     */
+    void updateSortTimer();
+
+    /**
+     * Gets the number of steps a turbo tick may run, from the speed slider
+     *
+     * @return Steps per tick, from 1 to about a million
+     */
+    size_t turboSteps() const;
+
+    /**
+     * Runs one tick of the sort: a step, or a batch of them in turbo mode
+     */
+    void runSortStep();
+
+    /**
+     * Moves each run block of m_unslottedRuns that has landed into its
+     * slot; the others stay listed
+     */
+    void slotLandedRuns();
+
+    std::thread m_externalSortThread;          //!< Runs ExternalSort off the GUI thread
+    std::atomic<bool> m_cancelExternalSort{ false };
+    bool m_externalSortRunning = false;
+    std::map<uint32_t, PhysicsBlock*> m_runBlocks;  //!< External sort run blocks by run id
+    std::vector<PhysicsBlock*> m_unslottedRuns;    //!< Run blocks to slot once they land
+    bool m_showingRuns = false;                    //!< Sorting waits for a reset meanwhile
+
     QLabel* sortedLabel;
     bool areBlocksSettled() const;
     void updateButtonStates();
@@ -0,0 +1,66 @@
+/**
+ * mappedfile.h
+ *
+ * This file defines the MappedFile class, a read-only view of a whole file.
+ */
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * MappedFile
+ *
+ * Maps a file into memory for reading, so large inputs are paged in by the
+ * operating system as they are touched instead of being copied up front.
+ * The mapping is advised for sequential access. Where memory mapping is
+ * not available the file is read into memory instead.
+ */
+class MappedFile {
+public:
+    /**
+     * Maps a file
+     *
+     * @param path The file to map; check error() for failures
+     */
+    explicit MappedFile(const std::string& path);
+
+    /**
+     * Unmaps the file
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Gets the contents
+     *
+     * @return The first byte, or null for an empty or unreadable file
+     */
+    const char* data() const { return m_data; }
+
+    /**
+     * Gets the size of the file in bytes
+     */
+    size_t size() const { return m_size; }
+
+    /**
+     * Gets why the file could not be mapped
+     *
+     * @return The reason, or an empty string on success
+     */
+    const std::string& error() const { return m_error; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_error;
+#if defined(_WIN32)
+    std::vector<char> m_buffer;
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,87 @@
+/**
+ * parallelsort.h
+ *
+ * This file defines the ParallelSort class which runs merge sort and
+ * quicksort on a WorkStealingPool and records what every task did.
+ */
+#ifndef PARALLELSORT_H
+#define PARALLELSORT_H
+
+#include <cstdint>
+#include <vector>
+#include "sortengine.h"
+#include "sorttrace.h"
+#include "workstealingpool.h"
+
+/**
+ * ParallelSort
+ *
+ * Fork-join versions of merge sort (sort both halves in parallel, then
+ * merge) and quicksort (partition, then sort the smaller side in a new
+ * task). Each task records the subrange it handled, the worker that ran
+ * it and its counters, and can also record its events into a SortTrace
+ * using the same conventions as the sequential SortEngine algorithms.
+ *
+ * Ranges are split the same way regardless of scheduling and pivots
+ * depend only on the range, so the set of tasks and their events are
+ * deterministic; only worker assignment and timing vary between runs.
+ */
+class ParallelSort {
+public:
+    /**
+     * What one task did with its subrange
+     */
+    enum Phase : uint8_t {
+        LEAF,           //!< Sorted the whole subrange sequentially
+        MERGE,          //!< Merged its two sorted halves
+        PARTITION       //!< Partitioned it around a pivot
+    };
+
+    /**
+     * One finished task
+     */
+    struct Task {
+        Phase phase;
+        uint32_t lo;                // Subrange [lo, hi)
+        uint32_t hi;
+        uint32_t worker;            // Index of the pool worker that ran it
+        uint64_t sequence;          // Start order over the whole run
+        uint64_t startNs;           // Start, relative to the start of the run
+        uint64_t durationNs;
+        SortEngine::Stats stats;    // Events of this task only
+        SortTrace trace;            // Its events, if tracing was requested
+    };
+
+    /**
+     * Outcome of a parallel sort
+     */
+    struct Result {
+        SortEngine::Stats stats;    // Sum over all tasks, plus one event per task
+        std::vector<Task> tasks;    // Ordered by sequence
+    };
+
+    /**
+     * Gets the subrange size below which a task sorts sequentially
+     *
+     * @param n       Number of keys
+     * @param workers Number of pool workers
+     * @return About four tasks per worker, within [8, 8192]
+     */
+    static size_t grain(size_t n, unsigned workers);
+
+    /**
+     * Sorts keys in ascending order on a pool
+     *
+     * @param a     SortEngine::PARALLEL_MERGE or SortEngine::PARALLEL_QUICK
+     * @param keys  The keys to sort
+     * @param pool  The pool to run on
+     * @param trace True to record every task's events
+     * @param modelCache True to run every worker's key accesses through a
+     *                   private CacheModel, as each core has its own cache
+     * @return The counters and the finished tasks
+     */
+    static Result run(SortEngine::Algorithm a, std::vector<int>& keys,
+                      WorkStealingPool& pool, bool trace = false, bool modelCache = false);
+};
+
+#endif // PARALLELSORT_H
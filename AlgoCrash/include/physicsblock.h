@@ -9,20 +9,19 @@
 #ifndef PHYSICSBLOCK_H
 #define PHYSICSBLOCK_H
 
+#include "physicsworld.h"
 #include <QGraphicsRectItem>
-#include <QGraphicsSimpleTextItem>
-#include <Box2D/Box2D.h>
 
 static constexpr float kPixelsPerMeter = 100.0f;
 static constexpr float kRadiansToDegrees = 180.0f / M_PI;
-static constexpr float kLandingYThreshold    = -4.4f;
-static constexpr float kLandingYSnap         = -4.5f;
-static constexpr float kMoveSpeed            = 3.0f;
 /**
  * PhysicsBlock
  *
  * Represents a physical block in the simulation that follows Box2D physics
  * and is rendered using Qt graphics. Used to visualize values being sorted.
+ *
+ * The body lives in a PhysicsWorld, which may step it on another thread;
+ * the block only queues commands for it and follows its snapshots.
  */
 class PhysicsBlock : public QGraphicsRectItem
 {
@@ -30,17 +29,33 @@ public:
 
     /*!
      * \brief Constructs a block at world coordinates (\a x,\a y) with a displayed integer \a value.
-     * \param world  Box2D world which creates the body.
+     * \param world  Physics world which creates the body.
      * \param x      Horizontal position in Box2D.
      * \param y      Vertical position in Box2D.
      * \param value  A displayed integer shown on the block
      */
-    PhysicsBlock(b2World* world, float x, float y, int value);
+    PhysicsBlock(PhysicsWorld* world, float x, float y, int value);
+
+    /**
+     * Gives a block whose body was destroyed a new body and value, as if
+     * it had just been constructed; used by BlockPool
+     *
+     * @param x     Horizontal position in Box2D.
+     * @param y     Vertical position in Box2D.
+     * @param value A displayed integer shown on the block
+     */
+    void respawn(float x, float y, int value);
 
     /**
-     * Updates the graphical position to match the physics position
+     * Updates the graphical position to match the latest physics snapshot,
+     * blended between its last two states by PhysicsWorld::alpha().
+     * A body that is resting where it was last synced is skipped without
+     * touching the item, so settled blocks cost nothing to repaint, and so
+     * are snapshots taken before the block's latest command was applied.
+     *
+     * @return True if the item moved or turned
      */
-    void syncWithPhysics();
+    bool syncWithPhysics();
 
     /**
      * Moves the block to the specified index position
@@ -49,6 +64,27 @@ public:
      */
     void moveToPosition(size_t index);
 
+    /**
+     * Places the block at the specified index position at once, without
+     * animating, and leaves it resting there
+     *
+     * @param index The target position index
+     */
+    void placeAtPosition(size_t index);
+
+    /**
+     * Stops the block where it is, upright, and leaves it resting there
+     */
+    void freeze();
+
+    /**
+     * Gets the horizontal world position of an index slot
+     *
+     * @param index The position index
+     * @return The slot's x coordinate in meters
+     */
+    static float slotX(size_t index);
+
     /**
      * Checks if the block is currently moving
      *
@@ -56,6 +92,13 @@ public:
      */
     bool isMoving() const { return m_isMoving; }
 
+    /**
+     * Checks if the block has come to rest: landed, placed or frozen
+     *
+     * @return True if the block is resting
+     */
+    bool isResting() const { return m_resting; }
+
     /**
      * Highlights the block for visualization purposes
      *
@@ -65,11 +108,19 @@ public:
     void highlight(bool isActive, bool isSorted = false);
 
     /**
-     * Gets the Box2D body of this block
+     * Tints the block with the colour of the parallel worker that last
+     * touched it; shown whenever the block is not highlighted
      *
-     * @return The Box2D body
+     * @param worker The worker index, or -1 for no tint
      */
-    b2Body* getBody() const { return body; }
+    void setWorker(int worker);
+
+    /**
+     * Gets the id of this block's body in its PhysicsWorld
+     *
+     * @return The body id
+     */
+    PhysicsWorld::BodyId bodyId() const { return m_id; }
 
     /**
      * Gets the value of this block
@@ -83,18 +134,31 @@ public:
      * @param newValue The new value to display
      */
     void setValue(int newValue);
+
+    /**
+     * Draws the block and its value, the value from the shared LabelAtlas
+     */
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
+               QWidget* widget = nullptr) override;
+
     bool isActiveHighlight() const { return m_activeHighlight; }
     bool isSortedHighlight() const { return m_sortedHighlight; }
 
 
 private:
-    b2Body* body;                       // Box2D representation
-    QGraphicsSimpleTextItem* label;     // Numeric label
+    PhysicsWorld* m_world;              // Owner of the body
+    PhysicsWorld::BodyId m_id;          // Body in m_world
+    uint32_t m_serial;                  // Creation of m_id that is ours
+    uint64_t m_pending      = 0;        // Latest command sent to the body
     int m_value;                        // Stored integer
     bool m_isMoving;                    // Animation flag
-    b2Vec2 m_targetPosition;            // Destination for animation
+    bool m_resting          = false;    // Body is static as of the last sync
     bool m_activeHighlight  = false;
     bool m_sortedHighlight  = false;
+    int m_worker            = -1;   // Parallel worker tint, -1 for none
+    bool m_synced           = false;    // m_syncedPos/m_syncedAngle are valid
+    b2Vec2 m_syncedPos;                 // Body transform last given to the item
+    float m_syncedAngle     = 0.0f;
 };
 
 #endif // PHYSICSBLOCK_H
@@ -0,0 +1,358 @@
+/**
+ * physicsworld.h
+ *
+ * This file defines the PhysicsWorld class which owns the Box2D world of
+ * the blocks and steps it, on the GUI thread or on a thread of its own.
+ */
+#ifndef PHYSICSWORLD_H
+#define PHYSICSWORLD_H
+
+#include "tween.h"
+#include <Box2D/Box2D.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static constexpr float kLandingYThreshold    = -4.4f;
+static constexpr float kLandingYSnap         = -4.5f;
+static constexpr float kMoveSpeed            = 3.0f;
+
+/**
+ * PhysicsWorld
+ *
+ * The b2World is only ever touched by whoever steps it: the GUI timer
+ * through update(), or, once setThreaded(true), a worker thread stepping at
+ * 60 Hz so that physics spikes cannot stall input and painting.
+ *
+ * The GUI never calls Box2D directly. Bodies are named by BodyId, and
+ * everything done to them (creating, sliding, placing, freezing, gravity)
+ * is queued as a command and applied, in order, before the next step.
+ * After each step the transforms of the bodies are published into a
+ * triple buffer: the stepper fills one array while the GUI reads another,
+ * and finished arrays are handed over with a single atomic exchange, so
+ * neither side ever waits for the other. Only the entries a buffer missed
+ * since it was last filled are written, and each snapshot lists the
+ * bodies that changed since the one the GUI took before, so the GUI need
+ * not look at the others either.
+ *
+ * Every snapshot names the last command applied before it, which lets a
+ * block ignore transforms that predate its own latest command.
+ *
+ * Stepping follows the wall clock rather than the timer: each update (or
+ * worker wake-up) runs as many fixed 1/60 s steps as the time elapsed
+ * calls for, up to kMaxCatchUpSteps, so timer jitter and slow frames no
+ * longer change the speed of the simulation. Snapshots hold the last two
+ * states of every body and the GUI draws one step behind, blended between
+ * them by alpha(), which keeps motion smooth on fast displays.
+ *
+ * The stepper keeps a list of the bodies that are falling or sliding and
+ * only ever looks at those; a body leaves it once it comes to rest, and
+ * only a command brings it back. Snapshots carry how many are still on
+ * the list, so asking whether everything has settled costs nothing.
+ *
+ * saveState() and restoreState() capture the whole world in a binary blob
+ * and bring it back: gravity, every block's transform, velocities, type
+ * and slide, and the impulses of its contacts, so that solving resumes
+ * warm-started where it left off.
+ */
+class PhysicsWorld {
+public:
+    using BodyId = uint32_t;
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * A body as of the latest snapshot
+     */
+    struct Transform {
+        float x = 0, y = 0;     // Position in meters
+        float angle = 0;        // Radians
+        float prevX = 0, prevY = 0, prevAngle = 0;  // The same one step earlier
+        uint32_t serial = 0;    // Which creation of the id this is; 0 if free
+        bool moving = false;    // Sliding to a target after moveTo()
+        bool resting = false;   // Static: landed, placed or frozen
+    };
+
+    /**
+     * Transforms of every body id after one step
+     */
+    struct Snapshot {
+        uint64_t applied = 0;       // Last command applied before the step
+        Clock::time_point time;     // Simulated time the step ended at
+        uint32_t unsettled = 0;     // Bodies not yet resting
+        uint32_t moving = 0;        // ... of which sliding after moveTo()
+        std::vector<Transform> bodies;
+        std::vector<BodyId> changed;    // Bodies that moved, came to rest or got a
+                                        // command since the GUI's previous snapshot
+    };
+
+    /**
+     * Creates the world, stepped by update() until setThreaded(true)
+     *
+     * @param gravity Initial gravity
+     */
+    explicit PhysicsWorld(const b2Vec2& gravity);
+
+    /**
+     * Stops the worker thread if there is one
+     */
+    ~PhysicsWorld();
+
+    PhysicsWorld(const PhysicsWorld&) = delete;
+    PhysicsWorld& operator=(const PhysicsWorld&) = delete;
+
+    /**
+     * Moves stepping to a worker thread or back to update()
+     *
+     * @param threaded True to step on a worker thread
+     */
+    void setThreaded(bool threaded);
+
+    bool isThreaded() const { return m_thread.joinable(); }
+
+    /**
+     * Called by the GUI once per frame: steps the world for the time since
+     * the last call unless a worker does, then takes the newest snapshot
+     *
+     * @return True if a new snapshot was taken
+     */
+    bool update();
+
+    /**
+     * Runs one fixed step at once, however little time has passed, and
+     * takes its snapshot at its current state; lets frames be rendered
+     * faster than real time. Only valid while not threaded.
+     */
+    void stepNow();
+
+    /**
+     * Gets the snapshot taken by the last update()
+     */
+    const Snapshot& snapshot() const { return m_buffers[m_readIndex]; }
+
+    /**
+     * Gets how far the last update() was between the previous and the
+     * current state of the snapshot
+     *
+     * @return 0 for the previous state through 1 for the current one
+     */
+    float alpha() const { return m_alpha; }
+
+    /**
+     * Checks if every body has come to rest and every command was applied
+     *
+     * @return True if nothing will move until the next command
+     */
+    bool isSettled() const;
+
+    /**
+     * Checks if a command is still waiting or a body is still sliding after
+     * moveTo(); bodies falling under gravity do not count
+     *
+     * @return True while an animation is under way
+     */
+    bool isAnimating() const;
+
+    /**
+     * Adds a static box for blocks to land on
+     *
+     * @param centre    Centre in meters
+     * @param halfWidth Half width in meters
+     * @param halfHeight Half height in meters
+     */
+    void addGround(const b2Vec2& centre, float halfWidth, float halfHeight);
+
+    /**
+     * Creates a dynamic 1 m block
+     *
+     * @param x      Horizontal position in meters
+     * @param y      Vertical position in meters
+     * @param serial Receives the serial that snapshots will carry for it
+     * @return The id of the new body
+     */
+    BodyId createBlock(float x, float y, uint32_t& serial);
+
+    /**
+     * Destroys a body; its id may be handed out again. The b2Body itself is
+     * only deactivated and kept, fixture and all, for a later createBlock()
+     *
+     * @param id The body
+     */
+    void destroyBody(BodyId id);
+
+    /**
+     * Slides a body horizontally to x, then leaves it static there. The
+     * body is made static once, if it was not already, and then carried
+     * along an eased tween by setting its transform every step, so it
+     * never changes type mid-slide (which would drop its contacts and
+     * rebuild its broadphase proxies). Another moveTo() retargets the
+     * slide from wherever the body is.
+     *
+     * @return The command's sequence number
+     */
+    uint64_t moveTo(BodyId id, float x);
+
+    /**
+     * Puts a body at x at once, upright and static
+     *
+     * @return The command's sequence number
+     */
+    uint64_t placeAt(BodyId id, float x);
+
+    /**
+     * Stops a body where it is, upright and static
+     *
+     * @return The command's sequence number
+     */
+    uint64_t freeze(BodyId id);
+
+    /**
+     * Sets the gravity of the world
+     *
+     * @param gravity The gravity in m/s²
+     */
+    void setGravity(const b2Vec2& gravity);
+
+    /**
+     * Captures the world once every command so far is applied; waits for
+     * the worker thread if there is one
+     *
+     * @return The state as a blob for restoreState()
+     */
+    std::vector<uint8_t> saveState();
+
+    /**
+     * Puts the world back in a state captured by saveState(). Bodies are
+     * matched by id and creation, so only the bodies that still exist are
+     * restored; bodies created since are left as they are.
+     *
+     * @param state A blob from saveState()
+     * @return False if the blob is malformed or a body in it is gone
+     */
+    bool restoreState(const std::vector<uint8_t>& state);
+
+    /**
+     * Gets the command of the last restoreState(); snapshots taken before it
+     * show bodies as they were before the restore
+     */
+    uint64_t lastRestore() const { return m_lastRestore; }
+
+private:
+    static constexpr float kTimeStep = 1.0f / 60.0f;
+    static constexpr int kVelocityIterations = 6;
+    static constexpr int kPositionIterations = 2;
+    static constexpr int kMaxCatchUpSteps = 5;  // Steps per update before time is dropped
+    static constexpr unsigned kFresh = 4;   // Set in m_shared when it holds an unread snapshot
+
+    // Bits of m_marks: which of the change lists hold a body
+    static constexpr uint8_t kChanged = 1;  // m_changed
+    static constexpr uint8_t kUnseen = 2;   // m_unseen
+    static constexpr uint8_t kStale = 4;    // m_stale[i], shifted left by i
+
+    struct Command {
+        enum Kind { GROUND, CREATE, DESTROY, MOVE_TO, PLACE_AT, FREEZE, GRAVITY, SAVE, RESTORE };
+        Kind kind;
+        BodyId id;
+        uint32_t serial;
+        float x, y, w, h;
+        std::vector<uint8_t>* state = nullptr;  // SAVE fills it, RESTORE reads it
+        std::promise<bool>* done = nullptr;     // Set once SAVE or RESTORE ran
+    };
+
+    /**
+     * A body as the stepper sees it
+     */
+    struct Body {
+        b2Body* body = nullptr;
+        uint32_t serial = 0;
+        bool moving = false;
+        Tween slide;                    // Horizontal position while moving
+        b2Vec2 prevPosition;            // Transform at the start of the step
+        float prevAngle = 0;
+        bool listed = false;            // In m_active
+    };
+
+    b2World m_world;
+    std::vector<Body> m_bodies;         // By id; stepper side only
+    std::vector<BodyId> m_active;       // Bodies that may move; stepper side only
+    std::vector<b2Body*> m_spareBodies; // Inactive blocks to reuse; stepper side only
+    uint32_t m_moving = 0;              // Sliding bodies in m_active; stepper side only
+
+    // Change lists, all stepper side only
+    std::vector<uint8_t> m_marks;       // By id, as m_bodies
+    std::vector<BodyId> m_changed;      // Bodies changed since the last publish
+    std::vector<BodyId> m_unseen;       // ... since the snapshot the GUI took last
+    std::vector<BodyId> m_stale[3];     // ... since each buffer was last written
+
+    // Commands, filled by the GUI and drained by the stepper
+    std::mutex m_commandMutex;
+    std::vector<Command> m_commands;
+    std::vector<Command> m_draining;    // Stepper side only
+    uint64_t m_nextCommand = 1;         // GUI side; guarded by m_commandMutex
+    uint64_t m_issued = 0;              // GUI side: last command enqueued
+    uint64_t m_lastRestore = 0;         // GUI side
+    b2Body* m_ground = nullptr;         // Stepper side only
+    uint64_t m_applied = 0;             // Stepper side only
+    Clock::time_point m_simTime = Clock::now(); // Stepper side only
+
+    // GUI-side id allocation
+    std::vector<BodyId> m_freeIds;
+    BodyId m_nextId = 0;
+    uint32_t m_nextSerial = 1;
+
+    // Triple buffer: stepper writes m_buffers[m_writeIndex], GUI reads
+    // m_buffers[m_readIndex], m_shared holds the third, maybe fresh
+    Snapshot m_buffers[3];
+    unsigned m_writeIndex = 0;
+    unsigned m_readIndex = 1;
+    std::atomic<unsigned> m_shared{ 2 };
+    float m_alpha = 1;                  // GUI side
+
+    std::thread m_thread;
+    std::atomic<bool> m_stop{ false };
+
+    uint64_t enqueue(const Command& c);
+
+    /**
+     * Runs the fixed steps due by now and publishes the result
+     *
+     * @param now The current time
+     */
+    void advance(Clock::time_point now);
+    void activate(BodyId id);
+
+    /**
+     * Notes that a body's transform changed, for the next publish
+     *
+     * @param id The body
+     */
+    void touch(BodyId id);
+
+    /**
+     * Adds a body to a change list unless its mark says it is on it
+     *
+     * @param id   The body
+     * @param bit  The list's bit in m_marks
+     * @param list The list
+     */
+    void mark(BodyId id, uint8_t bit, std::vector<BodyId>& list);
+
+    /**
+     * Runs a SAVE or RESTORE command and waits for it
+     *
+     * @return The command's result
+     */
+    bool runSynchronously(Command c);
+    void save(std::vector<uint8_t>& out) const;
+    bool restore(const std::vector<uint8_t>& in);
+    void stepOnce();
+    void applyCommands();
+    void updateBodies();
+    void publish();
+    void run();
+};
+
+#endif // PHYSICSWORLD_H
@@ -0,0 +1,201 @@
+/**
+ * replayfile.h
+ *
+ * This file defines the ReplayWriter and ReplayReader classes, which record
+ * the look of the blocks frame by frame into a compact file and play it
+ * back.
+ */
+#ifndef REPLAYFILE_H
+#define REPLAYFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+/**
+ * ReplayBlock
+ *
+ * One block as a replay frame shows it
+ */
+struct ReplayBlock {
+    float x, y;         // Centre in scene coordinates
+    float rotation;     // Degrees, as QGraphicsItem::rotation()
+    uint32_t rgb;       // Fill colour, highlights included
+    int32_t value;
+};
+
+/**
+ * ReplayWriter
+ *
+ * Appends frames to a replay file. Positions are quantized to 1/8 pixel
+ * and angles to 1/16 degree, and frames are grouped into chunks of up to
+ * kFramesPerChunk. A chunk starts with the block values and a key frame
+ * holding every block; each later frame only lists the blocks that
+ * changed, as deltas to the frame before, so a frame in which nothing
+ * moved takes one byte. A new chunk also starts whenever the blocks or
+ * their values change. An index of the chunks at the end of the file lets
+ * a reader seek to any frame by decoding at most one chunk.
+ *
+ * File layout (integers native-endian, "varint" LEB128, "zigzag" signed):
+ *
+ *   header: u32 magic "ACRP", u32 version, u32 frame period in ms
+ *   chunk:  u32 frames, u32 blocks, u32 payload bytes, then as varints the
+ *           zigzag values, the key frame (x, y, angle zigzag, rgb) and per
+ *           further frame the changed count and, per changed block, the
+ *           index gap, a field mask and the changed fields (zigzag deltas,
+ *           rgb whole)
+ *   index:  u32 chunks, then u64 file offset and u32 first frame per chunk
+ *   footer: u64 index offset, u32 magic "ACRI"
+ */
+class ReplayWriter {
+public:
+    static constexpr uint32_t kFramesPerChunk = 256;
+
+    /**
+     * Creates the file and writes its header
+     *
+     * @param path     The file to write; replaced if it exists
+     * @param periodMs Time between frames, for playback at the recorded speed
+     */
+    ReplayWriter(const std::string& path, uint32_t periodMs);
+
+    /**
+     * Finishes the file if finish() was not called
+     */
+    ~ReplayWriter();
+
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    /**
+     * Appends a frame; chunks are written to the file as they fill up
+     *
+     * @param blocks Every block of the frame, in a stable order
+     */
+    void addFrame(const std::vector<ReplayBlock>& blocks);
+
+    /**
+     * Writes the last chunk and the index and closes the file
+     *
+     * @return False if a write failed; see error()
+     */
+    bool finish();
+
+    /**
+     * Gets the number of frames added
+     */
+    uint64_t frames() const { return m_frames; }
+
+    /**
+     * Gets why writing failed
+     *
+     * @return The reason, or an empty string while all is well
+     */
+    const std::string& error() const { return m_error; }
+
+private:
+    /**
+     * A block as stored: quantized
+     */
+    struct Quantized {
+        int32_t x, y, angle;
+        uint32_t rgb;
+    };
+
+    std::FILE* m_file = nullptr;
+    std::string m_path;
+    std::string m_error;
+    uint64_t m_frames = 0;
+
+    // The open chunk
+    std::vector<uint8_t> m_payload;
+    std::vector<int32_t> m_values;
+    std::vector<Quantized> m_previous;  // Last frame added
+    std::vector<Quantized> m_current;   // Scratch for the frame being added
+    uint32_t m_chunkFrames = 0;
+
+    // Index entries of the chunks written so far
+    std::vector<std::pair<uint64_t, uint32_t>> m_index;
+
+    void flushChunk();
+    void write(const void* data, size_t size);
+};
+
+/**
+ * ReplayReader
+ *
+ * Reads frames back from a file written by ReplayWriter. The file is
+ * memory mapped; reading frames in order decodes only the changes of each
+ * frame, and seeking decodes from the key frame of the target's chunk.
+ */
+class ReplayReader {
+public:
+    /**
+     * Opens a replay
+     *
+     * @param path The file to read; check error() for failures
+     */
+    explicit ReplayReader(const std::string& path);
+
+    ~ReplayReader();
+
+    ReplayReader(const ReplayReader&) = delete;
+    ReplayReader& operator=(const ReplayReader&) = delete;
+
+    /**
+     * Gets the number of frames in the replay
+     */
+    size_t frameCount() const { return m_frameCount; }
+
+    /**
+     * Gets the time between frames when recorded
+     */
+    uint32_t periodMs() const { return m_periodMs; }
+
+    /**
+     * Decodes a frame
+     *
+     * @param frame The frame, less than frameCount()
+     * @param out   Receives every block of the frame
+     * @return False if the frame is out of range or the file is damaged
+     */
+    bool readFrame(size_t frame, std::vector<ReplayBlock>& out);
+
+    /**
+     * Gets why the file could not be read
+     *
+     * @return The reason, or an empty string on success
+     */
+    const std::string& error() const { return m_error; }
+
+private:
+    struct Quantized {
+        int32_t x, y, angle;
+        uint32_t rgb;
+    };
+
+    std::unique_ptr<MappedFile> m_file;
+    std::string m_error;
+    uint32_t m_periodMs = 0;
+    size_t m_frameCount = 0;
+    std::vector<std::pair<uint64_t, uint32_t>> m_index;    // Offset and first frame per chunk
+
+    // Decoding position: the frame m_state shows, and where its successor starts
+    size_t m_chunk = SIZE_MAX;
+    size_t m_frame = 0;
+    uint32_t m_chunkFrames = 0;
+    size_t m_pos = 0;
+    size_t m_end = 0;
+    std::vector<int32_t> m_values;
+    std::vector<Quantized> m_state;
+
+    bool openChunk(size_t chunk);
+    bool nextFrame();
+};
+
+#endif // REPLAYFILE_H
@@ -0,0 +1,66 @@
+/**
+ * simdsort.h
+ *
+ * This file defines the SimdSort class, a vectorized int sort for large
+ * arrays outside the visualization.
+ */
+#ifndef SIMDSORT_H
+#define SIMDSORT_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * SimdSort
+ *
+ * High-throughput baseline next to the step-based teaching algorithms.
+ * Keys are first sorted in blocks held entirely in vector registers (a
+ * sorting network over the columns, a transpose, then a bitonic merge of
+ * row pairs), after which sorted runs are merged pairwise with a bitonic
+ * merge kernel that picks the next input vector without branching on the
+ * keys. Runs are merged within cache-sized chunks before the passes over
+ * the whole array.
+ *
+ * The instruction set is chosen at run time: AVX2, SSE4.1 or a scalar
+ * fallback with a branch-free merge. No event trace is produced.
+ */
+class SimdSort {
+public:
+    /**
+     * Kernel instruction sets, from least to most capable
+     */
+    enum Isa { SCALAR, SSE4, AVX2 };
+
+    /**
+     * Gets the most capable instruction set the CPU supports
+     *
+     * @return The instruction set sort() uses by default
+     */
+    static Isa bestIsa();
+
+    /**
+     * Gets the display name of an instruction set
+     *
+     * @param isa The instruction set
+     * @return A name such as "AVX2"
+     */
+    static const char* name(Isa isa);
+
+    /**
+     * Sorts keys in ascending order
+     *
+     * @param keys Pointer to the keys
+     * @param n    Number of keys
+     * @param isa  Kernels to use; anything above bestIsa() falls back to it
+     */
+    static void sort(int* keys, size_t n, Isa isa = bestIsa());
+
+    /**
+     * Sorts a vector of keys in ascending order with the best kernels
+     *
+     * @param keys The keys to sort
+     */
+    static void sort(std::vector<int>& keys) { sort(keys.data(), keys.size()); }
+};
+
+#endif // SIMDSORT_H
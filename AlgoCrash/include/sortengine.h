@@ -0,0 +1,155 @@
+/**
+ * sortengine.h
+ *
+ * This file defines the SortEngine class which runs the sorting algorithms
+ * on a plain key array, without any Qt or Box2D objects involved.
+ */
+#ifndef SORTENGINE_H
+#define SORTENGINE_H
+
+#include <cstdint>
+#include <vector>
+#include "cachemodel.h"
+#include "sortstepper.h"
+#include "sorttrace.h"
+
+/**
+ * SortEngine
+ *
+ * Headless sorting back end. Algorithms are coroutines operating directly
+ * on a contiguous std::vector<int>; they can either be stepped one event at
+ * a time (steps()) or drained at native speed (run()), optionally
+ * recording every compare/swap/highlight into a SortTrace that the
+ * SortingController replays onto PhysicsBlocks.
+ */
+class SortEngine {
+public:
+    /**
+     * Enumeration of the supported sorting algorithms
+     */
+    enum Algorithm {
+        BUBBLE, INSERTION, SELECTION, QUICK, MERGE, HEAP, SHELL,
+        BITONIC, ODD_EVEN, ODD_EVEN_MERGE,      // Sorting networks
+        PARALLEL_MERGE, PARALLEL_QUICK          // Work-stealing fork-join sorts
+    };
+
+    /**
+     * Number of entries in Algorithm
+     */
+    static constexpr int kAlgorithmCount = PARALLEL_QUICK + 1;
+
+    /**
+     * Counters collected while an algorithm runs. Memory traffic is
+     * derived from the events: a compare reads both keys, a swap reads and
+     * writes both, a move reads one key and writes it elsewhere.
+     */
+    struct Stats {
+        uint64_t comparisons = 0;
+        uint64_t swaps       = 0;
+        uint64_t moves       = 0;    // Element copies; a swap is three
+        uint64_t reads       = 0;    // Key reads
+        uint64_t writes      = 0;    // Key writes
+        uint64_t cacheMisses = 0;    // Lines a CacheModel fetched, if one was used
+        uint64_t events      = 0;    // Every yielded event, including FOCUS
+
+        Stats& operator+=(const Stats& o)
+        {
+            comparisons += o.comparisons;
+            swaps += o.swaps;
+            moves += o.moves;
+            reads += o.reads;
+            writes += o.writes;
+            cacheMisses += o.cacheMisses;
+            events += o.events;
+            return *this;
+        }
+    };
+
+    /**
+     * Gets the display name of an algorithm
+     *
+     * @param a The algorithm
+     * @return A human readable name, e.g. "Bubble Sort"
+     */
+    static const char* name(Algorithm a);
+
+    /**
+     * Checks if an algorithm is a sorting network. Networks emit their
+     * compare-exchanges in layers of independent pairs, each closed by a
+     * LAYER event, and run headless on all cores for large inputs.
+     *
+     * @param a The algorithm
+     * @return True for bitonic, odd-even transposition and odd-even merge sort
+     */
+    static bool isNetwork(Algorithm a);
+
+    /**
+     * Checks if an algorithm runs as tasks on a WorkStealingPool. Stepping
+     * such an algorithm runs it in parallel first and then replays its
+     * tasks in start order, each introduced by a TASK event naming the
+     * worker that ran it.
+     *
+     * @param a The algorithm
+     * @return True for the parallel merge sort and quicksort
+     */
+    static bool isParallel(Algorithm a);
+
+    /**
+     * Checks if stepping an algorithm takes time quadratic in the number of
+     * keys: either it compares that often, or its MOVE events shift whole
+     * runs of keys, which a replay has to repeat
+     *
+     * @param a The algorithm
+     * @return True for bubble, selection, insertion, odd-even transposition
+     *         and the (parallel) merge sorts
+     */
+    static bool isQuadratic(Algorithm a);
+
+    /**
+     * Starts an algorithm on @p keys without running it
+     *
+     * @param a    The algorithm to run
+     * @param keys The keys to sort; must outlive the returned stepper
+     * @return A stepper yielding one event per compare/swap/move/focus
+     */
+    static SortStepper steps(Algorithm a, std::vector<int>& keys);
+
+    /**
+     * Adds the effect of one event to @p stats
+     *
+     * @param stats The counters to update
+     * @param e     The event that just happened
+     * @param cache Optional cache model; the keys the event accessed are
+     *              run through it and its misses added to cacheMisses
+     */
+    static void count(Stats& stats, const TraceEvent& e, CacheModel* cache = nullptr);
+
+    /**
+     * Takes the effect of one event back out of @p stats; cacheMisses is
+     * left alone since it depends on the history before the event
+     *
+     * @param stats The counters to update
+     * @param e     The event that is being reverted
+     */
+    static void uncount(Stats& stats, const TraceEvent& e);
+
+    /**
+     * Sorts @p keys in place with the given algorithm
+     *
+     * @param a     The algorithm to run
+     * @param keys  The keys to sort
+     * @param trace Optional trace receiving every event; pass nullptr to
+     *              sort without recording (keys.size() must not exceed
+     *              SortTrace::kMaxIndex + 1 when recording). Large network
+     *              sorts and the parallel algorithms without a trace run
+     *              on all cores.
+     * @param cache Optional cache model fed with every key access; when
+     *              the sort runs on several threads each thread models a
+     *              private cache of its own instead
+     * @return The collected statistics
+     */
+    static Stats run(Algorithm a, std::vector<int>& keys, SortTrace* trace = nullptr,
+                     CacheModel* cache = nullptr);
+};
+
+#endif // SORTENGINE_H
@@ -9,15 +9,23 @@
 #ifndef SORTINGCONTROLLER_H
 #define SORTINGCONTROLLER_H
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
 #include <vector>
 #include "physicsblock.h"
+#include "sortengine.h"
+#include "undolog.h"
 
 /**
  * SortingController
  *
- * Manages the execution of different sorting algorithms on a collection
- * of PhysicsBlock objects, tracking statistics and providing step-by-step
- * visualization.
+ * Drives the visualization of a sorting algorithm on a collection of
+ * PhysicsBlock objects. The algorithm itself runs headless in SortEngine
+ * over a mirror of the block values; the controller pulls one event per
+ * step, records it into an UndoLog and applies it to the blocks,
+ * animating swaps and tracking statistics.
  */
 class SortingController {
 public:
@@ -26,15 +34,41 @@ public:
      */
     SortingController();
 
+    /**
+     * Stops counting the length of the run if that is still going on
+     */
+    ~SortingController();
+
+    SortingController(const SortingController&) = delete;
+    SortingController& operator=(const SortingController&) = delete;
+
     /**
      * Callback function to report status updates during sorting
      */
     std::function<void(const QString&)> statusCallback;
 
     /**
-     * Enumeration of the supported sorting algorithms
+     * Callback reporting whether the blocks are still sliding; without it
+     * step() polls every block while it waits for a swap to finish
      */
-    enum Algorithm { BUBBLE, INSERTION, SELECTION };
+    std::function<bool()> animatingCallback;
+
+    /**
+     * The supported sorting algorithms (see SortEngine::Algorithm)
+     */
+    using Algorithm = SortEngine::Algorithm;
+    static constexpr Algorithm BUBBLE    = SortEngine::BUBBLE;
+    static constexpr Algorithm INSERTION = SortEngine::INSERTION;
+    static constexpr Algorithm SELECTION = SortEngine::SELECTION;
+    static constexpr Algorithm QUICK     = SortEngine::QUICK;
+    static constexpr Algorithm MERGE     = SortEngine::MERGE;
+    static constexpr Algorithm HEAP      = SortEngine::HEAP;
+    static constexpr Algorithm SHELL     = SortEngine::SHELL;
+    static constexpr Algorithm BITONIC   = SortEngine::BITONIC;
+    static constexpr Algorithm ODD_EVEN  = SortEngine::ODD_EVEN;
+    static constexpr Algorithm ODD_EVEN_MERGE = SortEngine::ODD_EVEN_MERGE;
+    static constexpr Algorithm PARALLEL_MERGE = SortEngine::PARALLEL_MERGE;
+    static constexpr Algorithm PARALLEL_QUICK = SortEngine::PARALLEL_QUICK;
 
     /**
      * Sets the current algorithm and resets the controller
@@ -44,12 +78,41 @@ public:
     void setAlgorithm(Algorithm a) { m_algorithm = a; reset(); }
 
     /**
-     * Advances the current algorithm by one step
+     * Gets the current algorithm
+     */
+    Algorithm algorithm() const { return m_algorithm; }
+
+    /**
+     * Applies the next event of the algorithm, replaying it from the
+     * undo log if it was already recorded (e.g. after a step backward).
+     * Sorting networks advance by a whole layer: all of its
+     * compare-exchanges are highlighted and their swaps animate at once.
      *
      * @return False when sorting is complete, true otherwise
      */
     bool step();
 
+    /**
+     * Checks if the last step's swap is still animating, in which case the
+     * next step() would only wait
+     *
+     * @return True while step() would not advance
+     */
+    bool isAnimating() const;
+
+    /**
+     * Runs many steps at once for fast playback. Steps are applied to
+     * block indices only, without waiting for animations; once the batch
+     * is over the blocks are placed at their slots and highlights and
+     * worker tints are updated in a single pass. Sorting networks stop
+     * only between layers.
+     *
+     * @param maxSteps Most steps to run
+     * @param budget   Time after which no further step is started
+     * @return False when sorting is complete, true otherwise
+     */
+    bool turbo(size_t maxSteps, std::chrono::microseconds budget);
+
     /**
      * Sets the blocks to be sorted
      *
@@ -58,11 +121,45 @@ public:
     void setBlocks(std::vector<PhysicsBlock*>& blocks);
 
     /**
-     * Performs one step of the bubble sort algorithm
+     * Sorts a bare key array without blocks (headless mode), for arrays too
+     * large to simulate; the state is read back through order() and
+     * valueAt()
      *
-     * @return False when sorting is complete, true otherwise
+     * @param keys The values to sort
+     */
+    void setKeys(std::vector<int> keys);
+
+    /**
+     * Gets the number of values being sorted
+     */
+    size_t size() const { return m_order.size(); }
+
+    /**
+     * Gets the value at an index at the current step
+     *
+     * @param index The position, below size()
+     * @return The value there
+     */
+    int valueAt(size_t index) const { return m_initialKeys[m_order[index]]; }
+
+    /**
+     * Gets the values in the order they had at reset
+     */
+    const std::vector<int>& initialKeys() const { return m_initialKeys; }
+
+    /**
+     * Gets the current order, as indices into initialKeys()
+     */
+    const std::vector<uint32_t>& order() const { return m_order; }
+
+    /**
+     * Gets the pair of indices highlighted as being compared
+     *
+     * @param a Receives the first index
+     * @param b Receives the second index
+     * @return False if no pair is highlighted
      */
-    bool bubbleSortStep();
+    bool activePair(size_t& a, size_t& b) const;
 
     /**
      * Checks if sorting is complete
@@ -72,7 +169,8 @@ public:
     bool isSortingComplete() const;
 
     /**
-     * Resets the controller to its initial state
+     * Resets the controller to its initial state and restarts the current
+     * algorithm over the current block (or key) order
      */
     void reset();
 
@@ -81,28 +179,73 @@ public:
      *
      * @return The number of comparisons performed
      */
-    int getComparisonCount() const { return m_comparisonCount; }
+    uint64_t getComparisonCount() const { return m_stats.comparisons; }
 
     /**
      * Gets the current swap count
      *
      * @return The number of swaps performed
      */
-    int getSwapCount() const { return m_swapCount; }
+    uint64_t getSwapCount() const { return m_stats.swaps; }
 
     /**
-     * Performs one step of the insertion sort algorithm
+     * Gets all counters at the current step, including the element reads,
+     * writes and moves and the misses of a simulated cache over the keys
      *
-     * @return False when sorting is complete, true otherwise
+     * @return The statistics of the run up to the current step
      */
-    bool insertionSortStep();
+    const SortEngine::Stats& stats() const { return m_stats; }
 
     /**
-     * Performs one step of the selection sort algorithm
+     * Jumps to any step of the run. The nearest checkpoint at or before
+     * @p step is found by binary search and only the records since then
+     * are replayed, on block indices alone; the blocks are then put at
+     * their new slots directly instead of animating every swap on the
+     * way (short jumps slide, long ones are placed instantly).
      *
-     * @return False when sorting is complete, true otherwise
+     * @param step The target step, clamped to totalSteps() once that is
+     *             known; the end of the run otherwise
+     */
+    void seek(size_t step);
+
+    /**
+     * Gets the number of events applied so far
+     *
+     * @return The current position on the timeline
+     */
+    size_t currentStep() const { return m_log.position(); }
+
+    /**
+     * Gets the number of events of the whole run. Except for small arrays
+     * it is counted on a thread of its own after every reset, so that
+     * resetting a large array does not wait for a dry run of the sort.
+     *
+     * @return The length of the timeline, or 0 while it is being counted
+     */
+    size_t totalSteps() const;
+
+    /**
+     * Checks if the length of the run has been counted
+     *
+     * @return True once totalSteps() is valid
+     */
+    bool isLengthKnown() const;
+
+    /**
+     * Gets the log of applied events
+     *
+     * @return The undo log of the current run
+     */
+    const UndoLog& undoLog() const { return m_log; }
+
+    /**
+     * Reverts the most recent step by undoing its logged event, or the
+     * events of the last layer for sorting networks. The order is restored
+     * in O(1); the simulated cache is recomputed from the closest cache
+     * checkpoint, replaying fewer than kCacheCheckpointInterval records.
+     *
+     * @return False if there is nothing to undo
      */
-    bool selectionSortStep();
     bool restoreState();
 
     /**
@@ -110,37 +253,156 @@ public:
     *
     * @return True if history is empty, false otherwise
     */
-    bool isHistoryEmpty() const { return history.empty(); }
+    bool isHistoryEmpty() const { return m_log.position() == 0 && !m_isComplete; }
 
     /**
-     * After a restore, re-highlight the two blocks that would
-     * next be compared (or the current “min” in selection),
-     * or show the sorted state if complete.
+     * After a restore, re-highlight the two blocks of the last applied
+     * comparison, or show the sorted state if complete. For parallel
+     * algorithms the worker tints are rebuilt from the log as well.
      */
     void reapplyHighlights();
 
 
 private:
     /**
-     * Phases of the sorting algorithms
+     * Smallest number of log records between two checkpoints; larger
+     * arrays space them further apart so the element order they store
+     * costs about a quarter of a byte per record (plus the fixed size
+     * of the simulated cache).
+     */
+    static constexpr size_t kMinCheckpointInterval = 4096;
+
+    /**
+     * Number of log records between two cache checkpoints, which bounds
+     * the replay that recomputes the simulated cache after an undo
      */
-    enum Phase { HIGHLIGHT, ACTION };
-    Phase m_phase;
+    static constexpr size_t kCacheCheckpointInterval = 4096;
+
+    /**
+     * Longest seek (in steps) that is still animated
+     */
+    static constexpr size_t kAnimatedSeekLimit = 32;
+
+    /**
+     * Most keys whose run is counted at once by reset(); larger arrays are
+     * counted by m_counter, unless the algorithm is parallel
+     */
+    static constexpr size_t kInlineCountLimit = 256;
+
     std::vector<PhysicsBlock*> m_blocks;
-    size_t m_currentIndex;
-    size_t m_lastSortedIndex;
+    std::vector<PhysicsBlock*> m_initialBlocks; // Block order at reset
+    std::vector<uint32_t> m_order;      // m_blocks as indices into m_initialBlocks
+    std::vector<int> m_initialKeys;     // Values in m_initialBlocks order
+    std::vector<int> m_keys;            // Values the algorithm sorts
+    SortStepper m_stepper;              // Running algorithm over m_keys
+    UndoLog m_log;                      // Every event pulled from m_stepper
+    std::atomic<size_t> m_totalSteps;   // Events in the whole run, kNone while counted
+    std::thread m_counter;              // Counts them after a reset of a large array
+    std::atomic<bool> m_cancelCount{ false };
     bool m_isComplete;
     bool m_isSwapping;
-    int m_comparisonCount;
-    int m_swapCount;
+    SortEngine::Stats m_stats;          // Counters at the current step
+    CacheModel m_cache;                 // Simulated cache at the current step
+    int m_currentWorker = -1;           // Worker of the last TASK event applied
+    Algorithm m_algorithm = BUBBLE;
 
-    /* Insertion‑sort bookkeeping */
-    size_t m_outerIdx;
-    size_t m_innerIdx;
+    static constexpr size_t kNone = SIZE_MAX;
+    size_t m_activeA = kNone;           // Highlighted comparison, kNone for none
+    size_t m_activeB = kNone;
 
-    /* Selection-sort bookkeeping */
-    size_t m_minIndex;
-    Algorithm m_algorithm = BUBBLE;
+    /**
+     * Gets the next event to apply, from the undo log if it was already
+     * recorded, otherwise from the algorithm (and records it)
+     *
+     * @param e Receives the event
+     * @return False if the run is over
+     */
+    bool nextEvent(TraceEvent& e);
+
+    /**
+     * Applies a whole network layer, starting with its first event,
+     * and reports it as one step
+     *
+     * @param e The first event of the layer
+     */
+    void applyLayer(TraceEvent e);
+
+    /**
+     * Puts every block at the slot m_order gives it
+     *
+     * @param animate True to slide blocks over, false to place them directly
+     */
+    void placeBlocks(bool animate);
+
+    /**
+     * Applies one trace event to the blocks
+     *
+     * @param e The event to apply
+     */
+    void applyEvent(const TraceEvent& e);
+
+    /**
+     * Reverts the effect of one trace event on the blocks and counters
+     *
+     * @param e The event to revert
+     */
+    void revertEvent(const TraceEvent& e);
+
+    /**
+     * Applies or reverts one event on m_order and the counters only
+     *
+     * @param e       The event
+     * @param forward True to apply it, false to revert it
+     */
+    void replay(const TraceEvent& e, bool forward);
+
+    /**
+     * Tints the blocks an event touched with the current worker's colour
+     *
+     * @param e An event that was just applied
+     */
+    void tintWorker(const TraceEvent& e);
+
+    /**
+     * Recomputes every block's worker tint by replaying the log up to
+     * the current position
+     */
+    void rebuildWorkerTints();
+
+    /**
+     * Recomputes the simulated cache and its miss count for the current
+     * step from the closest checkpoint, after stepping backwards
+     */
+    void syncCache();
+
+    /**
+     * Starts counting the events of the run over m_keys, at once for small
+     * arrays and parallel algorithms and on m_counter otherwise
+     */
+    void startCounting();
+
+    /**
+     * Cancels and joins m_counter if it runs
+     */
+    void stopCounting();
+
+    /**
+     * Gets the length of the run for status messages
+     *
+     * @return The number of events, or "?" while it is being counted
+     */
+    QString totalStepsText() const;
+
+    /**
+     * Stores an undo log checkpoint, or a cache checkpoint, if one is due
+     * at the current step
+     */
+    void checkpointIfDue();
+
+    /**
+     * Marks the sort complete and lines every block up in sorted order
+     */
+    void finish();
 
     /**
      * Performs a swap between two blocks and animates it
@@ -151,31 +413,26 @@ private:
     void performSwap(size_t index1, size_t index2);
 
     /**
-     * Saves the current state into history
+     * Moves one block to another index, shifting the blocks in between
+     * by one place, and animates every block that changed position
+     *
+     * @param from The index of the block to move
+     * @param to   The index it should end up at
      */
-    void saveState();
+    void performMove(size_t from, size_t to);
 
     /**
-     * Struct to represent one complete snapshot of the sort state
+     * Takes the comparison highlight off every block
      */
-    struct SortState {
-        Phase phase;
-        size_t currentIndex;
-        size_t lastSortedIndex;
-        bool isComplete;
-        bool isSwapping;
-        int comparisonCount;
-        int swapCount;
-        size_t outerIdx;
-        size_t innerIdx;
-        size_t minIndex;
-        Algorithm algorithm;
-        std::vector<PhysicsBlock*> blocks;
-        std::vector<bool> wasActiveHighlight;
-        std::vector<bool> wasSortedHighlight;
-    };
+    void clearHighlights();
 
-    std::vector<SortState> history;
+    /**
+     * Highlights two indices as being compared, on top of any others
+     *
+     * @param a The first index
+     * @param b The second index
+     */
+    void highlightPair(size_t a, size_t b);
 };
 
 #endif // SORTINGCONTROLLER_H
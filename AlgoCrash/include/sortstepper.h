@@ -0,0 +1,95 @@
+/**
+ * sortstepper.h
+ *
+ * This file defines the SortStepper class, a C++20 coroutine generator that
+ * lets sorting algorithms be written as ordinary loops which suspend at
+ * every compare/swap they perform.
+ */
+#ifndef SORTSTEPPER_H
+#define SORTSTEPPER_H
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include "sorttrace.h"
+
+/**
+ * SortStepper
+ *
+ * Resumable handle to a running sort. An algorithm is a coroutine that
+ * returns SortStepper and does `co_yield TraceEvent{...}` for each event;
+ * the caller pulls events one at a time with next(). The algorithm applies
+ * its own changes to the key array, so after next() returns an event the
+ * keys already reflect it.
+ */
+class SortStepper {
+public:
+    struct promise_type {
+        TraceEvent current{};
+
+        SortStepper get_return_object()
+        {
+            return SortStepper(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(TraceEvent e) noexcept
+        {
+            current = e;
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    SortStepper() = default;
+    SortStepper(SortStepper&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr)) {}
+    SortStepper& operator=(SortStepper&& other) noexcept
+    {
+        if (this != &other) {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+    SortStepper(const SortStepper&) = delete;
+    SortStepper& operator=(const SortStepper&) = delete;
+    ~SortStepper()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    /**
+     * Resumes the algorithm until its next event
+     *
+     * @param out Receives the event
+     * @return False once the algorithm has finished, true otherwise
+     */
+    bool next(TraceEvent& out)
+    {
+        if (!m_handle || m_handle.done())
+            return false;
+        m_handle.resume();
+        if (m_handle.done())
+            return false;
+        out = m_handle.promise().current;
+        return true;
+    }
+
+    /**
+     * Checks if the algorithm has run to completion
+     *
+     * @return True if there are no more events
+     */
+    bool done() const { return !m_handle || m_handle.done(); }
+
+private:
+    explicit SortStepper(std::coroutine_handle<promise_type> h) : m_handle(h) {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+#endif // SORTSTEPPER_H
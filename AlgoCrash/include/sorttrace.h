@@ -0,0 +1,124 @@
+/**
+ * sorttrace.h
+ *
+ * This file defines the SortTrace class, a compact binary log of the
+ * compare/swap/highlight events produced by a headless sort run.
+ */
+#ifndef SORTTRACE_H
+#define SORTTRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * TraceEvent
+ *
+ * One decoded event of a sort trace. Indices refer to positions in the
+ * key array at the moment the event was emitted.
+ */
+struct TraceEvent {
+    enum Op : uint8_t {
+        COMPARE,    //!< Keys at a and b were compared
+        SWAP,       //!< Keys at a and b were exchanged
+        MOVE,       //!< Key at a was lifted out and reinserted at b, shifting the keys between
+        FOCUS,      //!< Index a became the algorithm's point of interest (min, pivot, ...)
+        LAYER,      //!< Closes network layer a; the events since the last LAYER are independent
+        TASK        //!< Worker a starts a parallel task at index b; the events up to the next TASK are its own
+    };
+
+    Op op;
+    uint32_t a;
+    uint32_t b;
+};
+
+/**
+ * SortTrace
+ *
+ * Append-only sequence of TraceEvents packed into 8 bytes each: the first
+ * index in one word, the opcode in the top three bits of the second word
+ * and the second index in its low 29 bits. Fixed-width records keep the
+ * trace randomly addressable, so it can be replayed forwards or backwards
+ * from any event. Indices are therefore limited to kMaxIndex.
+ */
+class SortTrace {
+public:
+    static constexpr uint32_t kMaxIndex = (1u << 29) - 1;
+
+    /**
+     * Appends one event to the end of the trace
+     *
+     * @param op The event type
+     * @param a  First index
+     * @param b  Second index (ignored by single-index events)
+     */
+    void append(TraceEvent::Op op, size_t a, size_t b = 0)
+    {
+        m_records.push_back({ static_cast<uint32_t>(a),
+                              (static_cast<uint32_t>(op) << 29)
+                                  | (static_cast<uint32_t>(b) & kMaxIndex) });
+    }
+
+    /**
+     * Decodes the event at position @p i
+     *
+     * @param i Event index, must be less than size()
+     * @return The decoded event
+     */
+    TraceEvent at(size_t i) const
+    {
+        const Record& r = m_records[i];
+        return { static_cast<TraceEvent::Op>(r.bOp >> 29), r.a, r.bOp & kMaxIndex };
+    }
+
+    /**
+     * Gets the number of recorded events
+     *
+     * @return The event count
+     */
+    size_t size() const { return m_records.size(); }
+
+    /**
+     * Checks if the trace holds no events
+     *
+     * @return True if no event was recorded
+     */
+    bool empty() const { return m_records.empty(); }
+
+    /**
+     * Gets the memory used by the encoded events
+     *
+     * @return Size of the encoded trace in bytes
+     */
+    size_t byteSize() const { return m_records.size() * sizeof(Record); }
+
+    /**
+     * Reserves room for @p events events
+     */
+    void reserve(size_t events) { m_records.reserve(events); }
+
+    /**
+     * Drops every event past the first @p events
+     */
+    void truncate(size_t events)
+    {
+        if (events < m_records.size())
+            m_records.resize(events);
+    }
+
+    /**
+     * Removes all events
+     */
+    void clear() { m_records.clear(); }
+
+private:
+    struct Record {
+        uint32_t a;
+        uint32_t bOp;
+    };
+    static_assert(sizeof(Record) == 8, "trace records must stay 8 bytes");
+
+    std::vector<Record> m_records;
+};
+
+#endif // SORTTRACE_H
@@ -0,0 +1,78 @@
+/**
+ * tween.h
+ *
+ * This file defines the Tween class which eases a value from one number to
+ * another over a fixed time.
+ */
+#ifndef TWEEN_H
+#define TWEEN_H
+
+/**
+ * Tween
+ *
+ * A timeline for one animated value. Each tween keeps its own clock, which
+ * its owner advances by the time step, so every animation runs for its own
+ * duration however many others are under way and whenever it started.
+ */
+class Tween
+{
+public:
+    /**
+     * Shapes of the curve from start to end
+     */
+    enum Easing {
+        LINEAR,         // Constant speed
+        EASE_IN_OUT     // Accelerates, then slows down to a stop
+    };
+
+    /**
+     * Creates a finished tween resting at 0
+     */
+    Tween() = default;
+
+    /**
+     * Creates a tween at the start of its timeline
+     *
+     * @param from     Starting value
+     * @param to       Final value
+     * @param duration Time to reach the final value, in seconds; 0 ends at once
+     * @param easing   Shape of the curve
+     */
+    Tween(float from, float to, float duration, Easing easing = EASE_IN_OUT);
+
+    /**
+     * Moves the timeline forward
+     *
+     * @param dt Time to advance, in seconds
+     * @return The value at the new time
+     */
+    float advance(float dt);
+
+    /**
+     * Gets the value at the current time
+     *
+     * @return The eased value, exactly the final value once finished
+     */
+    float value() const;
+
+    /**
+     * Checks if the timeline has reached its end
+     *
+     * @return True once the duration has passed
+     */
+    bool isFinished() const { return m_elapsed >= m_duration; }
+
+    /**
+     * Gets the final value
+     */
+    float target() const { return m_to; }
+
+private:
+    float m_from = 0;
+    float m_to = 0;
+    float m_duration = 0;
+    float m_elapsed = 0;
+    Easing m_easing = EASE_IN_OUT;
+};
+
+#endif // TWEEN_H
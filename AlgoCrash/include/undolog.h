@@ -0,0 +1,223 @@
+/**
+ * undolog.h
+ *
+ * This file defines the UndoLog class, a delta-encoded, reversible record of
+ * the events a SortingController has applied, with periodic checkpoints.
+ */
+#ifndef UNDOLOG_H
+#define UNDOLOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "cachemodel.h"
+#include "sortengine.h"
+#include "sorttrace.h"
+
+/**
+ * UndoLog
+ *
+ * Stores one record per applied TraceEvent instead of a snapshot of the
+ * whole block array. Each record holds the opcode and the index deltas
+ * relative to the previous record, so the common neighbour compares and
+ * swaps take a single byte. Records can be walked in both directions:
+ * undo() steps back over the last record in O(1), redo() steps forward
+ * again over records that were undone.
+ *
+ * Every checkpointInterval records the owner may also store a Checkpoint
+ * with the full element order and counters, giving random access points
+ * into the log without replaying it from the start. Independently, every
+ * cacheCheckpointInterval records it may store a cache checkpoint holding
+ * only the counters and the simulated cache, which are small; these keep
+ * recomputing the cache after an undo short even when large arrays space
+ * the full checkpoints far apart.
+ *
+ * Encoding: a short record is one header byte
+ *   bits 0-2 op, bits 3-4 b code (0: b = a + 1, 1: b = a - 1, 2: b = a),
+ *   bits 5-7 zigzag(a - previous a) in 0..6.
+ * Anything else is a long record: the header (b code 3 and/or delta code 7)
+ * followed by the varint fields that did not fit, and a trailer byte
+ * (length << 3 | 7) so the record can be found when reading backwards.
+ */
+class UndoLog {
+public:
+    /**
+     * Full state at one log position
+     */
+    struct Checkpoint {
+        size_t step;                    // Log position the checkpoint describes
+        size_t offset;                  // Byte offset of that position
+        uint32_t lastA;                 // Delta decoder state at that position
+        SortEngine::Stats stats;        // Counters at that position
+        std::vector<uint32_t> order;    // Element order, as indices into the order at reset;
+                                        // empty in cache checkpoints
+        CacheModel cache;               // Simulated cache contents at that position
+    };
+
+    /**
+     * Removes all records and checkpoints
+     *
+     * @param checkpointInterval      Records between two checkpoints
+     * @param cacheCheckpointInterval Records between two cache checkpoints
+     */
+    void clear(size_t checkpointInterval, size_t cacheCheckpointInterval);
+
+    /**
+     * Appends a new event; only valid when nothing is left to redo
+     *
+     * @param e The event that was just applied
+     */
+    void push(const TraceEvent& e);
+
+    /**
+     * Steps back over the most recent record
+     *
+     * @param out Receives the event to revert
+     * @return False if already at the start of the log
+     */
+    bool undo(TraceEvent& out);
+
+    /**
+     * Steps forward over a record that was previously undone
+     *
+     * @param out Receives the event to re-apply
+     * @return False if there is nothing to redo
+     */
+    bool redo(TraceEvent& out);
+
+    /**
+     * Reads the most recent record without moving
+     *
+     * @param out Receives the event undo() would return
+     * @return False if at the start of the log
+     */
+    bool previous(TraceEvent& out) const;
+
+    /**
+     * Finds the most recent COMPARE at or before the current position
+     * without moving. Algorithms emit at most a few events between two
+     * comparisons, so this only looks at a handful of records.
+     *
+     * @param out Receives the comparison
+     * @return False if no comparison precedes the current position
+     */
+    bool lastCompare(TraceEvent& out) const;
+
+    /**
+     * Decodes the records before the current position, oldest first,
+     * without moving. Without @p from this walks the whole applied
+     * history, so it is meant for the short runs shown on screen.
+     *
+     * @param f    Called with each event in order
+     * @param from Checkpoint at or before the current position to start
+     *             at, or nullptr to start at the beginning of the log
+     */
+    void forEachApplied(const std::function<void(const TraceEvent&)>& f,
+                        const Checkpoint* from = nullptr) const;
+
+    /**
+     * Checks if a checkpoint should be stored for the current position
+     *
+     * @return True if the position is a multiple of the interval at the
+     *         end of the log and has no checkpoint yet
+     */
+    bool checkpointDue() const;
+
+    /**
+     * Stores a checkpoint for the current position
+     *
+     * @param stats The counters at this position
+     * @param order The element order at this position
+     * @param cache The simulated cache at this position
+     */
+    void addCheckpoint(const SortEngine::Stats& stats, const std::vector<uint32_t>& order,
+                       const CacheModel& cache);
+
+    /**
+     * Finds the last checkpoint at or before @p step by binary search.
+     * The owner stores one for step 0, so there always is one.
+     *
+     * @param step The log position to look for
+     * @return The closest preceding checkpoint
+     */
+    const Checkpoint& checkpointBefore(size_t step) const;
+
+    /**
+     * Checks if a cache checkpoint should be stored for the current position
+     *
+     * @return True if the position is a multiple of the cache interval at
+     *         the end of the log and has no cache checkpoint yet
+     */
+    bool cacheCheckpointDue() const;
+
+    /**
+     * Stores a cache checkpoint, without the element order, for the
+     * current position
+     *
+     * @param stats The counters at this position
+     * @param cache The simulated cache at this position
+     */
+    void addCacheCheckpoint(const SortEngine::Stats& stats, const CacheModel& cache);
+
+    /**
+     * Finds the last checkpoint of either kind at or before @p step, to
+     * recompute the simulated cache from; its order may be empty
+     *
+     * @param step The log position to look for
+     * @return The closest preceding checkpoint or cache checkpoint
+     */
+    const Checkpoint& cacheCheckpointBefore(size_t step) const;
+
+    /**
+     * Moves the current position to a checkpoint; records after it stay
+     * available to redo()
+     *
+     * @param c A checkpoint of this log
+     */
+    void rewind(const Checkpoint& c);
+
+    /**
+     * Gets the stored checkpoints, ordered by step
+     */
+    const std::vector<Checkpoint>& checkpoints() const { return m_checkpoints; }
+
+    /**
+     * Gets the number of records before the current position
+     */
+    size_t position() const { return m_position; }
+
+    /**
+     * Gets the number of records in the log, including undone ones
+     */
+    size_t size() const { return m_size; }
+
+    /**
+     * Gets the number of records between two checkpoints
+     */
+    size_t checkpointInterval() const { return m_checkpointInterval; }
+
+    /**
+     * Gets the memory used by records and checkpoints
+     *
+     * @return Size of the log in bytes
+     */
+    size_t byteSize() const;
+
+private:
+    /** Decodes the record ending at @p end, given the a of that record */
+    static TraceEvent decodeBackward(const std::vector<uint8_t>& bytes, size_t& end,
+                                     uint32_t& lastA);
+
+    std::vector<uint8_t> m_bytes;
+    size_t m_offset = 0;                // Byte offset of the current position
+    size_t m_position = 0;
+    size_t m_size = 0;
+    uint32_t m_lastA = 0;               // a of the record before the current position
+    size_t m_checkpointInterval = 0;
+    size_t m_cacheCheckpointInterval = 0;
+    std::vector<Checkpoint> m_checkpoints;
+    std::vector<Checkpoint> m_cacheCheckpoints;     // Order left empty
+};
+
+#endif // UNDOLOG_H
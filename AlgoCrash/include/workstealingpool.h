@@ -0,0 +1,125 @@
+/**
+ * workstealingpool.h
+ *
+ * This file defines the WorkStealingPool class, a fork-join thread pool in
+ * which idle workers steal queued jobs from busy ones.
+ */
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * WorkStealingPool
+ *
+ * Every worker owns a deque of jobs. Jobs spawned by a worker go to the
+ * back of its own deque and the worker takes them back from there (newest
+ * first, while its data is still in cache); a worker that runs dry steals
+ * from the front of another worker's deque, which holds the oldest and
+ * usually largest pieces of work.
+ *
+ * Worker 0 is the thread calling run(); the pool starts one thread for
+ * each of the others. Threads waiting on a TaskGroup keep running jobs
+ * instead of blocking, so recursive fork-join code cannot starve the pool.
+ */
+class WorkStealingPool {
+public:
+    using Job = std::function<void()>;
+
+    /**
+     * A set of spawned jobs that can be waited for together
+     */
+    class TaskGroup {
+        friend class WorkStealingPool;
+        std::atomic<size_t> m_pending{ 0 };
+    };
+
+    /**
+     * Starts the pool
+     *
+     * @param workers Number of workers including the caller of run();
+     *                at least 1
+     */
+    explicit WorkStealingPool(unsigned workers);
+
+    /**
+     * Stops and joins the worker threads; no jobs may still be queued
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * Gets a process-wide pool with one worker per hardware thread
+     *
+     * @return The shared pool
+     */
+    static WorkStealingPool& shared();
+
+    /**
+     * Gets the number of workers, including the caller of run()
+     */
+    unsigned size() const { return unsigned(m_workers.size()); }
+
+    /**
+     * Gets the index of the worker running the current job
+     *
+     * @return The worker index, or -1 outside of run() and the pool threads
+     */
+    int currentWorker() const;
+
+    /**
+     * Runs a job on the calling thread as worker 0. Jobs it spawns may run
+     * on any worker; run() returns when @p job returns, so the job should
+     * wait for its groups. Calls from several threads are serialized.
+     *
+     * @param job The root job
+     */
+    void run(const Job& job);
+
+    /**
+     * Queues a job on the current worker's deque; only valid inside run()
+     *
+     * @param group The group to account the job to
+     * @param job   The job
+     */
+    void spawn(TaskGroup& group, Job job);
+
+    /**
+     * Runs queued jobs until every job of @p group has finished; only
+     * valid inside run()
+     *
+     * @param group The group to wait for
+     */
+    void wait(TaskGroup& group);
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    /** Runs one job from worker @p self's deque or stolen from another */
+    bool runOne(unsigned self);
+
+    void workerLoop(unsigned index);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;     // Workers 1..size()-1
+    std::mutex m_runMutex;                  // One run() at a time
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_queued{ 0 };      // Jobs in all deques
+    bool m_stop = false;                    // Guarded by m_sleepMutex
+};
+
+#endif // WORKSTEALINGPOOL_H
@@ -0,0 +1,225 @@
+/**
+ * arrayviewitem.cpp
+ *
+ * This file implements the ArrayViewItem class which draws arrays too large
+ * for physics blocks at a level of detail that suits the zoom.
+ */
+#include "arrayviewitem.h"
+#include "labelatlas.h"
+#include "sortingcontroller.h"
+#include <QGraphicsSceneMouseEvent>
+#include <QGraphicsSceneWheelEvent>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr qreal kBlockMinPixels = 24.0; // Device pixels per element for blocks
+    constexpr qreal kBarMinPixels = 1.0;    // ... and for a bar per element
+    constexpr double kMinWindow = 2.0;      // Fewest elements the zoom shows
+    constexpr qreal kHeadroom = 0.9;        // Share of the height the tallest bar takes
+    constexpr qreal kBlockSide = 80.0;      // Side of a PhysicsBlock, where labels are scale 1
+
+    const QColor kIdle(70, 110, 180);
+    const QColor kActive(Qt::yellow);
+    const QColor kSorted(Qt::green);
+}
+
+ArrayViewItem::ArrayViewItem(const SortingController& controller, const QRectF& area)
+    : m_controller(controller)
+    , m_area(area)
+{
+    setFlag(QGraphicsItem::ItemClipsToShape);
+    setAcceptedMouseButtons(Qt::LeftButton);
+    setCursor(Qt::OpenHandCursor);
+}
+
+void ArrayViewItem::reset()
+{
+    const std::vector<int>& keys = m_controller.initialKeys();
+    if (keys.empty()) {
+        m_min = m_max = 0;
+    } else {
+        const auto [lo, hi] = std::minmax_element(keys.begin(), keys.end());
+        m_min = *lo;
+        m_max = *hi;
+    }
+    m_first = 0;
+    m_count = double(keys.size());
+    m_columnsStep = SIZE_MAX;
+    update();
+}
+
+void ArrayViewItem::refresh()
+{
+    if (m_controller.currentStep() != m_shownStep
+        || m_controller.isSortingComplete() != m_shownComplete)
+        update();
+}
+
+qreal ArrayViewItem::barHeight(int value) const
+{
+    const double range = double(m_max - m_min) + 1;
+    return std::max(m_area.height() * kHeadroom * (double(value - m_min) + 1) / range, 1.0);
+}
+
+void ArrayViewItem::setWindow(double first, double count)
+{
+    const double n = double(m_controller.size());
+    m_count = std::clamp(count, std::min(kMinWindow, n), n);
+    m_first = std::clamp(first, 0.0, n - m_count);
+    update();
+}
+
+void ArrayViewItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
+                          QWidget* widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+    m_shownStep = m_controller.currentStep();
+    m_shownComplete = m_controller.isSortingComplete();
+    if (m_controller.size() == 0 || m_count <= 0)
+        return;
+
+    // Elements partly inside the window are drawn too, clipped by the item
+    const size_t first = size_t(m_first);
+    const size_t last = std::min(m_controller.size(), size_t(std::ceil(m_first + m_count)));
+    const qreal slot = m_area.width() / m_count;
+    const qreal pixels = painter->worldTransform().mapRect(m_area).width();
+    const qreal slotPixels = pixels / m_count;
+
+    if (slotPixels >= kBlockMinPixels)
+        paintBlocks(painter, first, last, slot);
+    else if (slotPixels >= kBarMinPixels)
+        paintBars(painter, first, last, slot);
+    else
+        paintColumns(painter, int(std::ceil(pixels)));
+}
+
+void ArrayViewItem::paintBlocks(QPainter* painter, size_t first, size_t last, qreal slot)
+{
+    // Squares on the floor, as in the physics scene, sized to the slot
+    const qreal side = std::min(slot * 0.8, m_area.height() * 0.5);
+    const qreal labelScale = side / kBlockSide;
+    size_t a = SIZE_MAX, b = SIZE_MAX;
+    m_controller.activePair(a, b);
+
+    const LabelAtlas& atlas = LabelAtlas::shared();
+    m_fragments.clear();
+    painter->setPen(QPen(Qt::black, 0));
+    for (size_t i = first; i < last; ++i) {
+        const qreal x = m_area.left() + (double(i) - m_first) * slot + (slot - side) / 2;
+        const QRectF r(x, m_area.bottom() - side, side, side);
+        painter->setBrush(m_shownComplete ? kSorted
+                          : (i == a || i == b) ? kActive : QColor(Qt::white));
+        painter->drawRect(r);
+
+        // Labels that would overflow their block are left off
+        const int value = m_controller.valueAt(i);
+        if (atlas.width(value) * labelScale <= side)
+            atlas.append(m_fragments, r.center(), value, 0, labelScale);
+    }
+    atlas.draw(painter, m_fragments);
+}
+
+void ArrayViewItem::paintBars(QPainter* painter, size_t first, size_t last, qreal slot)
+{
+    size_t a = SIZE_MAX, b = SIZE_MAX;
+    m_controller.activePair(a, b);
+
+    std::vector<QRectF> bars;
+    bars.reserve(last - first);
+    std::vector<QRectF> active;
+    for (size_t i = first; i < last; ++i) {
+        const qreal h = barHeight(m_controller.valueAt(i));
+        const QRectF r(m_area.left() + (double(i) - m_first) * slot, m_area.bottom() - h,
+                       slot, h);
+        (i == a || i == b ? active : bars).push_back(r);
+    }
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(m_shownComplete ? kSorted : kIdle);
+    painter->drawRects(bars.data(), int(bars.size()));
+    painter->setBrush(kActive);
+    painter->drawRects(active.data(), int(active.size()));
+}
+
+void ArrayViewItem::paintColumns(QPainter* painter, int width)
+{
+    // One min/max span per device column; rebuilt only when something moved
+    if (m_columnsStep != m_shownStep || m_columnsFirst != m_first
+        || m_columnsCount != m_count || m_columnsWidth != width) {
+        m_columnsStep = m_shownStep;
+        m_columnsFirst = m_first;
+        m_columnsCount = m_count;
+        m_columnsWidth = width;
+        m_columns.clear();
+        m_columns.reserve(size_t(width));
+
+        const qreal columnWidth = m_area.width() / width;
+        const size_t n = m_controller.size();
+        for (int c = 0; c < width; ++c) {
+            const size_t begin = size_t(m_first + m_count * c / width);
+            const size_t end = std::min(n, std::max(begin + 1,
+                                                    size_t(m_first + m_count * (c + 1) / width)));
+            if (begin >= n)
+                break;
+            int lo = m_controller.valueAt(begin);
+            int hi = lo;
+            for (size_t i = begin + 1; i < end; ++i) {
+                const int v = m_controller.valueAt(i);
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+            }
+            const qreal top = m_area.bottom() - barHeight(hi);
+            const qreal bottom = std::max(m_area.bottom() - barHeight(lo), top + 1.0);
+            m_columns.emplace_back(m_area.left() + c * columnWidth, top, columnWidth,
+                                   bottom - top);
+        }
+    }
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(m_shownComplete ? kSorted : kIdle);
+    painter->drawRects(m_columns.data(), int(m_columns.size()));
+
+    // The compared pair is marked by the columns holding it
+    size_t a, b;
+    if (!m_shownComplete && m_controller.activePair(a, b)) {
+        painter->setBrush(kActive);
+        for (size_t i : { a, b }) {
+            const double c = (double(i) - m_first) * width / m_count;
+            if (c >= 0 && c < width) {
+                const size_t column = size_t(c);
+                if (column < m_columns.size())
+                    painter->drawRect(m_columns[column]);
+            }
+        }
+    }
+}
+
+void ArrayViewItem::wheelEvent(QGraphicsSceneWheelEvent* event)
+{
+    // Zoom around the element under the cursor
+    const double anchor = (event->pos().x() - m_area.left()) / m_area.width();
+    const double count = m_count * std::pow(0.999, event->delta());
+    setWindow(m_first + anchor * (m_count - count), count);
+    event->accept();
+}
+
+void ArrayViewItem::mousePressEvent(QGraphicsSceneMouseEvent* event)
+{
+    // Accepting the press is what routes the drag's moves here
+    event->accept();
+}
+
+void ArrayViewItem::mouseMoveEvent(QGraphicsSceneMouseEvent* event)
+{
+    const double dx = event->pos().x() - event->lastPos().x();
+    setWindow(m_first - dx / m_area.width() * m_count, m_count);
+}
+
+void ArrayViewItem::mouseDoubleClickEvent(QGraphicsSceneMouseEvent* event)
+{
+    setWindow(0, double(m_controller.size()));
+    event->accept();
+}
@@ -0,0 +1,163 @@
+/**
+ * blockarrayitem.cpp
+ *
+ * This file implements the BlockArrayItem class which draws a whole array
+ * of blocks as a single graphics item.
+ */
+#include "blockarrayitem.h"
+#include "labelatlas.h"
+#include "physicsblock.h"
+#include <QPainter>
+#include <QPolygonF>
+#include <QStyleOptionGraphicsItem>
+#include <QTransform>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr qreal kHalfSide = 40.0;           // Matches PhysicsBlock's 80 px rect
+    constexpr qreal kReach = kHalfSide * 1.5;   // Covers a tilted block and its pen
+    constexpr qreal kUpright = 0.01;            // Degrees below which no rotation is drawn
+    constexpr qreal kMinLabelSide = 16.0;       // On-screen pixels needed to show labels
+
+    QRectF blockRect(const QPointF& c)
+    {
+        return QRectF(c.x() - kHalfSide, c.y() - kHalfSide, 2 * kHalfSide, 2 * kHalfSide);
+    }
+
+    QRectF reachRect(const QPointF& c)
+    {
+        return QRectF(c.x() - kReach, c.y() - kReach, 2 * kReach, 2 * kReach);
+    }
+}
+
+BlockArrayItem::BlockArrayItem()
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+void BlockArrayItem::sync(const std::vector<PhysicsBlock*>& blocks)
+{
+    m_incoming.resize(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const PhysicsBlock* b = blocks[i];
+        m_incoming[i] = { b->pos(), b->rotation(), b->brush().color().rgb(), b->getValue() };
+    }
+    commitIncoming();
+}
+
+void BlockArrayItem::sync(const std::vector<ReplayBlock>& blocks)
+{
+    m_incoming.resize(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const ReplayBlock& b = blocks[i];
+        m_incoming[i] = { QPointF(b.x, b.y), b.rotation, QRgb(b.rgb), b.value };
+    }
+    commitIncoming();
+}
+
+void BlockArrayItem::commitIncoming()
+{
+    // Only blocks whose look changed are repainted, old and new place alike
+    const bool resized = m_incoming.size() != m_blocks.size();
+    m_blocks.resize(m_incoming.size());
+    QRectF dirty;
+    qreal left = 0, top = 0, right = 0, bottom = 0;
+    for (size_t i = 0; i < m_incoming.size(); ++i) {
+        const Block& now = m_incoming[i];
+        Block& out = m_blocks[i];
+        if (resized || now.pos != out.pos || now.rotation != out.rotation ||
+            now.fill != out.fill || now.value != out.value) {
+            if (!resized)
+                dirty |= reachRect(out.pos);
+            dirty |= reachRect(now.pos);
+            out = now;
+        }
+
+        if (i == 0) {
+            left = right = out.pos.x();
+            top = bottom = out.pos.y();
+        } else {
+            left = std::min(left, out.pos.x());
+            right = std::max(right, out.pos.x());
+            top = std::min(top, out.pos.y());
+            bottom = std::max(bottom, out.pos.y());
+        }
+    }
+
+    QRectF bounds;
+    if (!m_blocks.empty())
+        bounds = QRectF(QPointF(left, top), QPointF(right, bottom))
+                     .adjusted(-kReach, -kReach, kReach, kReach);
+    if (bounds != m_bounds) {
+        prepareGeometryChange();
+        m_bounds = bounds;
+    }
+    if (resized)
+        update();
+    else if (!dirty.isEmpty())
+        update(dirty);
+}
+
+QRectF BlockArrayItem::boundingRect() const
+{
+    return m_bounds;
+}
+
+void BlockArrayItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
+                           QWidget* widget)
+{
+    Q_UNUSED(widget);
+    const QRectF exposed = option->exposedRect.adjusted(-kReach, -kReach, kReach, kReach);
+
+    // Upright blocks, batched by colour; there are only a handful of colours
+    std::vector<std::pair<QRgb, std::vector<QRectF>>> batches;
+    std::vector<const Block*> tilted;
+    for (const Block& b : m_blocks) {
+        if (!exposed.contains(b.pos))
+            continue;
+        if (std::abs(b.rotation) >= kUpright) {
+            tilted.push_back(&b);
+            continue;
+        }
+        auto it = std::find_if(batches.begin(), batches.end(),
+                               [&](const auto& batch) { return batch.first == b.fill; });
+        if (it == batches.end()) {
+            batches.emplace_back(b.fill, std::vector<QRectF>());
+            it = batches.end() - 1;
+        }
+        it->second.push_back(blockRect(b.pos));
+    }
+
+    painter->setPen(QPen(Qt::black, 1));
+    for (const auto& [fill, rects] : batches) {
+        painter->setBrush(QColor::fromRgb(fill));
+        painter->drawRects(rects.data(), int(rects.size()));
+    }
+
+    // Tilted blocks are few (only while falling), so each gets its own polygon
+    for (const Block* b : tilted) {
+        QTransform t;
+        t.translate(b->pos.x(), b->pos.y());
+        t.rotate(b->rotation);
+        painter->setBrush(QColor::fromRgb(b->fill));
+        painter->drawConvexPolygon(t.map(QPolygonF(QRectF(-kHalfSide, -kHalfSide,
+                                                           2 * kHalfSide, 2 * kHalfSide))));
+    }
+
+    // Labels are unreadable when zoomed out; otherwise every digit of
+    // every label goes out in one atlas blit
+    const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform());
+    if (2 * kHalfSide * lod < kMinLabelSide)
+        return;
+
+    const LabelAtlas& atlas = LabelAtlas::shared();
+    m_fragments.clear();
+    for (const Block& b : m_blocks) {
+        if (exposed.contains(b.pos))
+            atlas.append(m_fragments, b.pos, b.value,
+                         std::abs(b.rotation) < kUpright ? 0 : b.rotation);
+    }
+    atlas.draw(painter, m_fragments);
+}
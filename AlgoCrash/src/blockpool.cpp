@@ -0,0 +1,36 @@
+/**
+ * blockpool.cpp
+ *
+ * This file implements the BlockPool class which recycles PhysicsBlocks
+ * between datasets.
+ */
+#include "blockpool.h"
+#include "physicsblock.h"
+
+BlockPool::BlockPool(PhysicsWorld* world)
+    : m_world(world)
+{
+}
+
+BlockPool::~BlockPool()
+{
+    for (PhysicsBlock* block : m_spare)
+        delete block;
+}
+
+PhysicsBlock* BlockPool::acquire(float x, float y, int value)
+{
+    if (m_spare.empty())
+        return new PhysicsBlock(m_world, x, y, value);
+
+    PhysicsBlock* block = m_spare.back();
+    m_spare.pop_back();
+    block->respawn(x, y, value);
+    return block;
+}
+
+void BlockPool::release(PhysicsBlock* block)
+{
+    m_world->destroyBody(block->bodyId());
+    m_spare.push_back(block);
+}
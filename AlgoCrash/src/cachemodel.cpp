@@ -0,0 +1,27 @@
+/**
+ * cachemodel.cpp
+ *
+ * This file implements the CacheModel class.
+ */
+#include "cachemodel.h"
+#include <algorithm>
+
+bool CacheModel::access(size_t index, size_t elementSize)
+{
+    const uint64_t line = uint64_t(index) * elementSize / kLineBytes;
+    uint32_t* set = m_lines.data() + (line % kSets) * kWays;
+    const uint32_t tag = uint32_t(line + 1);
+
+    // Hit: move the line to the front of its set
+    for (size_t way = 0; way < kWays; ++way) {
+        if (set[way] == tag) {
+            std::rotate(set, set + way, set + way + 1);
+            return false;
+        }
+    }
+
+    // Miss: evict the least recently used line
+    std::rotate(set, set + kWays - 1, set + kWays);
+    set[0] = tag;
+    return true;
+}
@@ -0,0 +1,239 @@
+/**
+ * datasetgenerator.cpp
+ *
+ * This file implements the DatasetGenerator class: the counter-based
+ * random source and the per-distribution key functions.
+ */
+#include "datasetgenerator.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+    constexpr uint64_t kGolden = 0x9e3779b97f4a7c15ull;
+    constexpr double kTwoPi = 6.283185307179586;
+
+    // Random streams, so that draws for different purposes are independent
+    constexpr uint64_t kValueStream = 0;
+    constexpr uint64_t kGaussianStream = 1;
+    constexpr uint64_t kZipfStream = 2;         // One per rejection attempt
+    constexpr uint64_t kFeistelStream = 1000;   // One per round
+
+    /* The splitmix64 finalizer: a bijective, well-mixing hash */
+    uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    /* Helpers of Hörmann and Derflinger's rejection-inversion sampler for
+       Zipf's law, written to stay accurate as the exponent nears 1 */
+    double helper1(double x)
+    {
+        return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+    }
+
+    double helper2(double x)
+    {
+        return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1 + x * 0.5 * (1 + x / 3 * (1 + 0.25 * x));
+    }
+
+    double h(double x, double exponent)
+    {
+        return std::exp(-exponent * std::log(x));
+    }
+
+    double hIntegral(double x, double exponent)
+    {
+        const double logX = std::log(x);
+        return helper2((1 - exponent) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x, double exponent)
+    {
+        const double t = std::max(-1.0, x * (1 - exponent));
+        return std::exp(helper1(t) * x);
+    }
+
+    /* The number of distinct ranks a Zipf key can take */
+    uint64_t zipfRanks(uint64_t count)
+    {
+        return std::clamp<uint64_t>(count, 1, INT_MAX);
+    }
+}
+
+const char* DatasetGenerator::name(Distribution d)
+{
+    switch (d) {
+    case UNIFORM:         return "uniform";
+    case GAUSSIAN:        return "gaussian";
+    case ZIPF:            return "zipf";
+    case NEARLY_SORTED:   return "nearly-sorted";
+    case REVERSED:        return "reversed";
+    case SAWTOOTH:        return "sawtooth";
+    case MANY_DUPLICATES: return "many-duplicates";
+    }
+    return "unknown";
+}
+
+DatasetGenerator::DatasetGenerator(Distribution d, uint64_t count, uint64_t seed, double parameter)
+    : m_distribution(d),
+    m_count(count),
+    m_key(mix(seed * kGolden + uint64_t(d) + 1)),
+    m_parameter(parameter)
+{
+    while (count > 1 && ((count - 1) >> m_shift) > uint64_t(INT_MAX))
+        ++m_shift;
+
+    const double root = std::ceil(std::sqrt(double(count)));
+    switch (d) {
+    case UNIFORM:
+        if (m_parameter < 1)
+            m_parameter = double(std::max<uint64_t>(count, 1));
+        m_parameter = std::min(std::floor(m_parameter), double(INT_MAX) + 1);
+        break;
+    case GAUSSIAN:
+        if (m_parameter <= 0)
+            m_parameter = double(count) / 6;
+        break;
+    case ZIPF: {
+        if (m_parameter <= 0)
+            m_parameter = 1;
+        const double ranks = double(zipfRanks(count));
+        m_hIntegralX1 = hIntegral(1.5, m_parameter) - 1;
+        m_hIntegralN = hIntegral(ranks + 0.5, m_parameter);
+        m_s = 2 - hIntegralInverse(hIntegral(2.5, m_parameter) - h(2, m_parameter), m_parameter);
+        break;
+    }
+    case NEARLY_SORTED:
+        if (m_parameter <= 0)
+            m_parameter = std::max(1.0, std::floor(double(count) / 64));
+        m_parameter = std::min(std::floor(m_parameter), double(count / 2));
+        break;
+    case REVERSED:
+        break;
+    case SAWTOOTH:
+        if (m_parameter < 1)
+            m_parameter = std::max(root, 1.0);
+        m_parameter = std::min(std::floor(m_parameter), double(INT_MAX));
+        break;
+    case MANY_DUPLICATES:
+        if (m_parameter < 1)
+            m_parameter = std::clamp(std::floor(std::sqrt(double(count))), 2.0, 8.0);
+        m_parameter = std::min(std::floor(m_parameter), double(INT_MAX) + 1);
+        break;
+    }
+}
+
+uint64_t DatasetGenerator::draw(uint64_t index, uint64_t stream) const
+{
+    return mix(mix(index ^ m_key) + stream * kGolden);
+}
+
+double DatasetGenerator::uniform(uint64_t index, uint64_t stream) const
+{
+    // 53 random bits in [0, 1)
+    return double(draw(index, stream) >> 11) * 0x1p-53;
+}
+
+int DatasetGenerator::ramp(uint64_t index) const
+{
+    return int(index >> m_shift);
+}
+
+uint64_t DatasetGenerator::permute(uint64_t x, uint64_t domain) const
+{
+    // A four-round Feistel network over the smallest even-width power of
+    // two covering the domain; values that land outside are walked again
+    unsigned bits = 0;
+    while ((uint64_t(1) << bits) < domain)
+        ++bits;
+    const unsigned half = (bits + 1) / 2;
+    if (half == 0)
+        return x;
+    const uint64_t mask = (uint64_t(1) << half) - 1;
+
+    do {
+        uint64_t l = x >> half;
+        uint64_t r = x & mask;
+        for (uint64_t round = 0; round < 4; ++round) {
+            const uint64_t t = l ^ (draw(r, kFeistelStream + round) & mask);
+            l = r;
+            r = t;
+        }
+        x = (l << half) | r;
+    } while (x >= domain);
+    return x;
+}
+
+int DatasetGenerator::zipf(uint64_t index) const
+{
+    const double ranks = double(zipfRanks(m_count));
+    for (uint64_t attempt = 0;; ++attempt) {
+        const double u = m_hIntegralN
+                         + uniform(index, kZipfStream + attempt) * (m_hIntegralX1 - m_hIntegralN);
+        const double x = hIntegralInverse(u, m_parameter);
+        const double k = std::clamp(std::floor(x + 0.5), 1.0, ranks);
+        if (k - x <= m_s || u >= hIntegral(k + 0.5, m_parameter) - h(k, m_parameter))
+            return int(k);
+    }
+}
+
+int DatasetGenerator::at(uint64_t index) const
+{
+    switch (m_distribution) {
+    case UNIFORM:
+        return int(draw(index, kValueStream) % uint64_t(m_parameter));
+    case GAUSSIAN: {
+        // Box-Muller; 1 - u keeps the logarithm finite
+        const double r = std::sqrt(-2 * std::log(1 - uniform(index, kValueStream)));
+        const double z = r * std::cos(kTwoPi * uniform(index, kGaussianStream));
+        const double v = std::round(double(m_count) / 2 + m_parameter * z);
+        return int(std::clamp(v, double(INT_MIN), double(INT_MAX)));
+    }
+    case ZIPF:
+        return zipf(index);
+    case NEARLY_SORTED: {
+        // Swapping disjoint adjacent pairs adds one inversion each; the
+        // pairs swapped are the first `parameter` of a random permutation
+        const uint64_t pairs = m_count / 2;
+        const uint64_t pair = index / 2;
+        if (pair < pairs && permute(pair, pairs) < uint64_t(m_parameter))
+            index ^= 1;
+        return ramp(index);
+    }
+    case REVERSED:
+        return ramp(m_count - 1 - index);
+    case SAWTOOTH:
+        return int(index % uint64_t(m_parameter));
+    case MANY_DUPLICATES:
+        return int(draw(index, kValueStream) % uint64_t(m_parameter));
+    }
+    return 0;
+}
+
+size_t DatasetGenerator::fill(uint64_t first, int* out, size_t n) const
+{
+    if (first >= m_count)
+        return 0;
+    n = size_t(std::min<uint64_t>(n, m_count - first));
+    for (size_t i = 0; i < n; ++i)
+        out[i] = at(first + i);
+    return n;
+}
+
+size_t DatasetGenerator::next(std::vector<int>& chunk)
+{
+    chunk.resize(size_t(std::min<uint64_t>(kChunkKeys, m_count - m_position)));
+    const size_t n = fill(m_position, chunk.data(), chunk.size());
+    m_position += n;
+    return n;
+}
+
+std::vector<int> DatasetGenerator::generate() const
+{
+    std::vector<int> keys(static_cast<size_t>(m_count));
+    fill(0, keys.data(), keys.size());
+    return keys;
+}
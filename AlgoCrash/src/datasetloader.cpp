@@ -0,0 +1,241 @@
+/**
+ * datasetloader.cpp
+ *
+ * This file implements the DatasetLoader class: cutting the mapped file
+ * into chunks and the per-chunk text and binary parsers.
+ */
+#include "datasetloader.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstring>
+
+namespace {
+    constexpr size_t kChunkBytes = size_t(1) << 20;     // Smallest chunk given its own job
+    constexpr size_t kMaxTokenText = 32;                // Longer bad tokens are shortened
+
+    /* What one chunk produced */
+    struct Chunk {
+        size_t begin;               // Byte range [begin, end) of the input
+        size_t end;
+        std::vector<int> keys;
+        uint64_t invalid = 0;
+        uint64_t outOfRange = 0;
+        std::vector<DatasetLoader::Sample> samples;
+    };
+
+    bool isSeparator(char c)
+    {
+        return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\n' || c == '\r'
+            || c == '\f' || c == '\v';
+    }
+
+    void reject(Chunk& chunk, uint64_t& counter, size_t offset, const char* token, size_t length)
+    {
+        ++counter;
+        if (chunk.samples.size() < DatasetLoader::kMaxSamples) {
+            std::string text(token, std::min(length, kMaxTokenText));
+            if (length > kMaxTokenText)
+                text += "...";
+            chunk.samples.push_back({ offset, std::move(text) });
+        }
+    }
+
+    void parseText(const char* data, Chunk& chunk)
+    {
+        const char* p = data + chunk.begin;
+        const char* const end = data + chunk.end;
+        chunk.keys.reserve((chunk.end - chunk.begin) / 4);
+
+        for (;;) {
+            while (p < end && isSeparator(*p))
+                ++p;
+            if (p == end)
+                break;
+            const char* const token = p;
+            while (p < end && !isSeparator(*p))
+                ++p;
+
+            // from_chars takes a leading minus sign only
+            const char* first = token;
+            if (*first == '+' && p - first > 1 && first[1] != '-')
+                ++first;
+
+            int value;
+            const auto [last, ec] = std::from_chars(first, p, value);
+            if (ec == std::errc() && last == p)
+                chunk.keys.push_back(value);
+            else if (ec == std::errc::result_out_of_range && last == p)
+                reject(chunk, chunk.outOfRange, size_t(token - data), token, size_t(p - token));
+            else
+                reject(chunk, chunk.invalid, size_t(token - data), token, size_t(p - token));
+        }
+    }
+
+    template <typename T>
+    void parseBinary(const char* data, Chunk& chunk)
+    {
+        chunk.keys.reserve((chunk.end - chunk.begin) / sizeof(T));
+        for (size_t offset = chunk.begin; offset < chunk.end; offset += sizeof(T)) {
+            T value;
+            std::memcpy(&value, data + offset, sizeof(T));
+            if (value >= T(INT_MIN) && value <= T(INT_MAX)) {
+                chunk.keys.push_back(int(value));
+            } else {
+                const std::string text = std::to_string(value);
+                reject(chunk, chunk.outOfRange, offset, text.data(), text.size());
+            }
+        }
+    }
+
+    /* Cuts [0, size) into chunks of about equal size; text chunks only
+       start right after a separator so no token is split */
+    std::vector<Chunk> cut(const char* data, size_t size, size_t unit, bool text,
+                           unsigned workers)
+    {
+        const size_t count = std::clamp<size_t>(size / kChunkBytes, 1, size_t(workers) * 4);
+        std::vector<Chunk> chunks(count);
+        size_t begin = 0;
+        for (size_t i = 0; i < count; ++i) {
+            size_t end = i + 1 == count ? size : (size / count) * (i + 1) / unit * unit;
+            end = std::max(end, begin);
+            if (text)
+                while (end < size && end > 0 && !isSeparator(data[end - 1]))
+                    ++end;
+            chunks[i].begin = begin;
+            chunks[i].end = end;
+            begin = end;
+        }
+        return chunks;
+    }
+
+    /* "1 entry was" or "<n> entries were", for the summary */
+    std::string entriesWere(uint64_t n)
+    {
+        return n == 1 ? "1 entry was" : std::to_string(n) + " entries were";
+    }
+}
+
+std::string DatasetLoader::Result::summary() const
+{
+    std::string text;
+    if (invalid)
+        text += entriesWere(invalid)
+                + (invalid == 1 ? " not a whole number" : " not whole numbers")
+                + " and skipped.\n";
+    if (outOfRange)
+        text += entriesWere(outOfRange) + " too large for an int and skipped.\n";
+    if (samples.empty())
+        return text;
+
+    text += invalid + outOfRange == 1 ? "Skipped entry:\n" : "First skipped entries:\n";
+    for (const Sample& s : samples)
+        text += "  byte " + std::to_string(s.offset) + ": " + s.token + "\n";
+    const uint64_t more = invalid + outOfRange - samples.size();
+    if (more)
+        text += "  ... and " + std::to_string(more) + " more\n";
+    return text;
+}
+
+DatasetLoader::Format DatasetLoader::formatFor(const std::string& path)
+{
+    const size_t dot = path.find_last_of('.');
+    std::string ext = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return char(std::tolower(c)); });
+
+    if (ext == "i32" || ext == "bin")
+        return INT32;
+    if (ext == "i64")
+        return INT64;
+    return TEXT;
+}
+
+DatasetLoader::Result DatasetLoader::load(const std::string& path, Format format,
+                                          WorkStealingPool& pool)
+{
+    const MappedFile file(path);
+    if (!file.error().empty()) {
+        Result result;
+        result.error = file.error();
+        return result;
+    }
+    return parse(file.data(), file.size(), format, pool);
+}
+
+DatasetLoader::Result DatasetLoader::parse(const char* data, size_t size, Format format,
+                                           WorkStealingPool& pool)
+{
+    Result result;
+    size_t unit = 1;
+    size_t start = 0;
+    if (format == INT32)
+        unit = sizeof(int32_t);
+    else if (format == INT64)
+        unit = sizeof(int64_t);
+    else if (size >= 3 && !std::memcmp(data, "\xEF\xBB\xBF", 3))
+        start = 3;                  // UTF-8 byte order mark
+
+    // A partial value at the end of a binary file is one bad token
+    const size_t tail = (size - start) % unit;
+    std::vector<Chunk> chunks = cut(data + start, size - start - tail, unit,
+                                    format == TEXT, pool.size());
+    for (Chunk& c : chunks) {
+        c.begin += start;
+        c.end += start;
+    }
+
+    const auto parseChunk = [data, format](Chunk& c) {
+        switch (format) {
+        case TEXT:  parseText(data, c); break;
+        case INT32: parseBinary<int32_t>(data, c); break;
+        case INT64: parseBinary<int64_t>(data, c); break;
+        }
+    };
+
+    if (chunks.size() == 1) {
+        parseChunk(chunks[0]);
+        result.keys = std::move(chunks[0].keys);
+    } else {
+        pool.run([&] {
+            WorkStealingPool::TaskGroup parsed;
+            for (Chunk& c : chunks)
+                pool.spawn(parsed, [&parseChunk, &c] { parseChunk(c); });
+            pool.wait(parsed);
+
+            size_t total = 0;
+            for (const Chunk& c : chunks)
+                total += c.keys.size();
+            result.keys.resize(total);
+
+            // Copy every chunk to its place in parallel too
+            WorkStealingPool::TaskGroup copied;
+            size_t at = 0;
+            for (Chunk& c : chunks) {
+                int* const out = result.keys.data() + at;
+                at += c.keys.size();
+                pool.spawn(copied, [&c, out] {
+                    std::copy(c.keys.begin(), c.keys.end(), out);
+                    std::vector<int>().swap(c.keys);
+                });
+            }
+            pool.wait(copied);
+        });
+    }
+
+    for (Chunk& c : chunks) {
+        result.invalid += c.invalid;
+        result.outOfRange += c.outOfRange;
+        for (Sample& s : c.samples)
+            if (result.samples.size() < kMaxSamples)
+                result.samples.push_back(std::move(s));
+    }
+    if (tail) {
+        ++result.invalid;
+        if (result.samples.size() < kMaxSamples)
+            result.samples.push_back({ size - tail, std::to_string(tail) + " trailing bytes" });
+    }
+    return result;
+}
@@ -0,0 +1,530 @@
+/**
+ * externalsort.cpp
+ *
+ * This file implements the ExternalSort class: the background I/O thread,
+ * double-buffered run readers and writers, the loser tree and the run
+ * formation and merge passes.
+ */
+#include "externalsort.h"
+#include "mappedfile.h"
+#include "simdsort.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+    namespace fs = std::filesystem;
+    using Clock = std::chrono::steady_clock;
+
+    /* Runs I/O jobs one after another on its own thread; every job returns
+       the number of keys it read or wrote */
+    class IoThread {
+    public:
+        IoThread() : m_thread(&IoThread::loop, this) {}
+
+        ~IoThread()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_one();
+            m_thread.join();
+        }
+
+        std::future<size_t> submit(std::function<size_t()> job)
+        {
+            std::packaged_task<size_t()> task(std::move(job));
+            std::future<size_t> done = task.get_future();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push_back(std::move(task));
+            }
+            m_wake.notify_one();
+            return done;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<std::packaged_task<size_t()>> m_jobs;
+        bool m_stop = false;
+        std::thread m_thread;       // Last, so the rest exists when it starts
+
+        void loop()
+        {
+            for (;;) {
+                std::packaged_task<size_t()> task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+                    if (m_jobs.empty())
+                        return;
+                    task = std::move(m_jobs.front());
+                    m_jobs.pop_front();
+                }
+                task();
+            }
+        }
+    };
+
+    /* Reads a run front to back; the next buffer is read in the
+       background while the current one is consumed */
+    class RunReader {
+    public:
+        RunReader(IoThread& io, const fs::path& path, size_t bufferKeys)
+            : m_io(io), m_file(std::fopen(path.string().c_str(), "rb")),
+            m_front(bufferKeys), m_back(bufferKeys)
+        {
+            if (!m_file)
+                return;
+            prefetch();
+            refill();
+        }
+
+        ~RunReader()
+        {
+            if (m_pending.valid())
+                m_pending.wait();
+            if (m_file)
+                std::fclose(m_file);
+        }
+
+        RunReader(const RunReader&) = delete;
+        RunReader& operator=(const RunReader&) = delete;
+
+        bool ok() const { return m_file && !m_failed; }
+        bool done() const { return m_pos == m_size; }
+        int key() const { return m_front[m_pos]; }
+
+        void advance()
+        {
+            if (++m_pos == m_size)
+                refill();
+        }
+
+    private:
+        IoThread& m_io;
+        FILE* m_file;
+        std::vector<int> m_front;       // Being consumed
+        std::vector<int> m_back;        // Being read
+        std::future<size_t> m_pending;  // The read into m_back
+        size_t m_pos = 0;
+        size_t m_size = 0;
+        bool m_failed = false;
+
+        void prefetch()
+        {
+            int* const buffer = m_back.data();
+            const size_t count = m_back.size();
+            FILE* const file = m_file;
+            m_pending = m_io.submit([buffer, count, file] {
+                return std::fread(buffer, sizeof(int), count, file);
+            });
+        }
+
+        void refill()
+        {
+            m_size = m_pending.get();
+            m_pos = 0;
+            if (m_size == 0) {
+                m_failed = std::ferror(m_file) != 0;
+                return;
+            }
+            std::swap(m_front, m_back);
+            prefetch();
+        }
+    };
+
+    /* Writes a run; one buffer is written in the background while the
+       other is filled */
+    class RunWriter {
+    public:
+        RunWriter(IoThread& io, const fs::path& path, size_t bufferKeys)
+            : m_io(io), m_file(std::fopen(path.string().c_str(), "wb")),
+            m_front(bufferKeys), m_back(bufferKeys)
+        {
+        }
+
+        ~RunWriter()
+        {
+            wait();
+            if (m_file)
+                std::fclose(m_file);
+        }
+
+        RunWriter(const RunWriter&) = delete;
+        RunWriter& operator=(const RunWriter&) = delete;
+
+        bool ok() const { return m_file && !m_failed; }
+
+        void push(int key)
+        {
+            m_front[m_count++] = key;
+            if (m_count == m_front.size())
+                flush();
+        }
+
+        bool close()
+        {
+            flush();
+            wait();
+            const bool closed = std::fclose(m_file) == 0;
+            m_file = nullptr;
+            return closed && !m_failed;
+        }
+
+    private:
+        IoThread& m_io;
+        FILE* m_file;
+        std::vector<int> m_front;       // Being filled
+        std::vector<int> m_back;        // Being written
+        std::future<size_t> m_pending;  // The write of m_back
+        size_t m_count = 0;             // Keys in m_front
+        size_t m_expected = 0;          // Keys in m_back
+        bool m_failed = false;
+
+        void wait()
+        {
+            if (m_pending.valid() && m_pending.get() != m_expected)
+                m_failed = true;
+        }
+
+        void flush()
+        {
+            if (m_count == 0)
+                return;
+            wait();
+            std::swap(m_front, m_back);
+
+            const int* const buffer = m_back.data();
+            const size_t count = m_count;
+            FILE* const file = m_file;
+            m_expected = count;
+            m_pending = m_io.submit([buffer, count, file] {
+                return std::fwrite(buffer, sizeof(int), count, file);
+            });
+            m_count = 0;
+        }
+    };
+
+    /* A tree of losers over k runs: every internal node holds the run
+       that lost the match played there, node 0 the overall winner, so
+       replacing the winner's key replays only its path to the root */
+    class LoserTree {
+    public:
+        explicit LoserTree(std::vector<RunReader*> runs)
+            : m_runs(std::move(runs)), m_losers(m_runs.size(), m_runs.size())
+        {
+            // Index k stands for a key below every other while building
+            for (size_t i = m_runs.size(); i-- > 0;)
+                replay(i);
+        }
+
+        bool empty() const { return m_runs[m_losers[0]]->done(); }
+        int top() const { return m_runs[m_losers[0]]->key(); }
+
+        void pop()
+        {
+            const size_t winner = m_losers[0];
+            m_runs[winner]->advance();
+            replay(winner);
+        }
+
+    private:
+        std::vector<RunReader*> m_runs;
+        std::vector<size_t> m_losers;
+
+        /* True if run a's key goes out before run b's; finished runs go last */
+        bool before(size_t a, size_t b) const
+        {
+            const size_t k = m_runs.size();
+            if (a == k || b == k)
+                return a == k;
+            const RunReader& ra = *m_runs[a];
+            const RunReader& rb = *m_runs[b];
+            if (ra.done() || rb.done())
+                return !ra.done();
+            return ra.key() < rb.key() || (ra.key() == rb.key() && a < b);
+        }
+
+        void replay(size_t s)
+        {
+            for (size_t t = (s + m_runs.size()) / 2; t > 0; t /= 2)
+                if (before(m_losers[t], s))
+                    std::swap(s, m_losers[t]);
+            m_losers[0] = s;
+        }
+    };
+
+    /* A run on disk */
+    struct RunFile {
+        uint32_t id;
+        uint64_t keys;
+        fs::path path;
+    };
+
+    /* Names the temporary run files of one sort and deletes whatever is
+       left of them when the sort ends, successful or not */
+    class Spill {
+    public:
+        explicit Spill(fs::path dir)
+            : m_dir(std::move(dir)),
+            m_tag(std::to_string(uint64_t(std::chrono::system_clock::now().time_since_epoch().count())
+                                 ^ uint64_t(reinterpret_cast<uintptr_t>(this))))
+        {
+        }
+
+        ~Spill()
+        {
+            std::error_code ec;
+            for (const fs::path& p : m_paths)
+                fs::remove(p, ec);
+        }
+
+        fs::path path(uint32_t run)
+        {
+            m_paths.push_back(m_dir / ("algocrash-" + m_tag + "-" + std::to_string(run) + ".run"));
+            return m_paths.back();
+        }
+
+    private:
+        fs::path m_dir;
+        std::string m_tag;
+        std::vector<fs::path> m_paths;
+    };
+
+    bool cancelled(const std::atomic<bool>* cancel)
+    {
+        return cancel && cancel->load(std::memory_order_relaxed);
+    }
+
+    bool mergeRuns(IoThread& reads, IoThread& writes, const std::vector<RunFile>& inputs,
+                   const fs::path& output, size_t bufferKeys, const std::atomic<bool>* cancel,
+                   std::string& error)
+    {
+        std::vector<std::unique_ptr<RunReader>> readers;
+        std::vector<RunReader*> runs;
+        for (const RunFile& run : inputs) {
+            readers.push_back(std::make_unique<RunReader>(reads, run.path, bufferKeys));
+            if (!readers.back()->ok()) {
+                error = "cannot read " + run.path.string();
+                return false;
+            }
+            runs.push_back(readers.back().get());
+        }
+
+        RunWriter writer(writes, output, bufferKeys);
+        if (!writer.ok()) {
+            error = "cannot write " + output.string();
+            return false;
+        }
+
+        size_t sinceCheck = 0;
+        for (LoserTree tree(runs); !tree.empty(); tree.pop()) {
+            writer.push(tree.top());
+            if (++sinceCheck == bufferKeys) {
+                sinceCheck = 0;
+                if (cancelled(cancel)) {
+                    error = "cancelled";
+                    return false;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < readers.size(); ++i) {
+            if (!readers[i]->ok()) {
+                error = "cannot read " + inputs[i].path.string();
+                return false;
+            }
+        }
+        if (!writer.close()) {
+            error = "cannot write " + output.string();
+            return false;
+        }
+        return true;
+    }
+}
+
+ExternalSort::Result ExternalSort::sortFile(const std::string& input, const std::string& output,
+                                            const Options& options, const Observer& observer)
+{
+    Result result;
+    std::error_code ec;
+    if (fs::equivalent(input, output, ec)) {
+        result.error = "the output must not be the input file";
+        return result;
+    }
+
+    const MappedFile file(input);
+    if (!file.error().empty()) {
+        result.error = file.error();
+        return result;
+    }
+    if (file.size() % sizeof(int32_t)) {
+        result.error = input + ": size is not a multiple of 4 bytes";
+        return result;
+    }
+
+    size_t offset = 0;
+    const Source source = [&file, &offset](int* out, size_t max) {
+        const size_t n = std::min(max, (file.size() - offset) / sizeof(int32_t));
+        std::memcpy(out, file.data() + offset, n * sizeof(int32_t));
+        offset += n * sizeof(int32_t);
+        return n;
+    };
+    return sort(source, output, options, observer);
+}
+
+ExternalSort::Result ExternalSort::sort(const Source& source, const std::string& output,
+                                        const Options& options, const Observer& observer)
+{
+    const auto start = Clock::now();
+    Result result;
+    const auto fail = [&result](std::string error) {
+        result.error = std::move(error);
+        return result;
+    };
+
+    const size_t runKeys = std::max<size_t>(options.memoryBytes / (2 * sizeof(int)), 1024);
+    const size_t fanIn = std::max<size_t>(options.fanIn, 2);
+    const size_t bufferKeys = std::max<size_t>(options.bufferKeys, 1024);
+
+    std::error_code ec;
+    fs::path dir = options.tempDir.empty() ? fs::temp_directory_path(ec) : fs::path(options.tempDir);
+    if (ec)
+        return fail("no temporary directory: " + ec.message());
+
+    Spill spill(dir);
+
+    // Run formation: sort one buffer while the other is written out
+    std::unique_ptr<int[]> buffers[2];
+    std::future<size_t> writing[2];
+    RunFile pending[2];
+    std::vector<RunFile> runs;
+
+    // Declared after the buffers so that, on early returns, queued writes
+    // finish before the buffers go away
+    IoThread reads;
+    IoThread writes;
+
+    const auto written = [&](int which) {
+        if (!writing[which].valid())
+            return true;
+        if (writing[which].get() != pending[which].keys)
+            return false;
+        runs.push_back(pending[which]);
+        if (observer)
+            observer({ Event::RUN_WRITTEN, 0, pending[which].id, pending[which].keys, {}, false });
+        return true;
+    };
+
+    uint32_t nextId = 0;
+    int which = 0;
+    for (;; which ^= 1) {
+        if (!written(which))
+            return fail("cannot write " + pending[which].path.string());
+        if (cancelled(options.cancel))
+            return fail("cancelled");
+        if (!buffers[which])
+            buffers[which].reset(new int[runKeys]);
+
+        int* const keys = buffers[which].get();
+        size_t n = 0;
+        while (n < runKeys) {
+            const size_t got = source(keys + n, runKeys - n);
+            if (got == 0)
+                break;
+            n += got;
+        }
+        if (n == 0)
+            break;
+
+        SimdSort::sort(keys, n);
+        const uint32_t id = nextId++;
+        pending[which] = { id, n, spill.path(id) };
+        result.keys += n;
+        writing[which] = writes.submit([keys, n, path = pending[which].path] {
+            FILE* f = std::fopen(path.string().c_str(), "wb");
+            if (!f)
+                return size_t(0);
+            size_t done = std::fwrite(keys, sizeof(int), n, f);
+            if (std::fclose(f) != 0)
+                done = 0;
+            return done;
+        });
+        if (n < runKeys)
+            break;
+    }
+    // The other buffer holds the older of the two runs still being written
+    for (int i : { which ^ 1, which })
+        if (!written(i))
+            return fail("cannot write " + pending[i].path.string());
+    buffers[0].reset();
+    buffers[1].reset();
+    result.runs = uint32_t(runs.size());
+
+    if (runs.empty()) {
+        FILE* f = std::fopen(output.c_str(), "wb");
+        if (!f || std::fclose(f) != 0)
+            return fail("cannot write " + output);
+    } else if (runs.size() == 1) {
+        // Already sorted: the only run becomes the output
+        fs::rename(runs[0].path, output, ec);
+        if (ec) {
+            fs::copy_file(runs[0].path, output, fs::copy_options::overwrite_existing, ec);
+            if (ec)
+                return fail("cannot write " + output + ": " + ec.message());
+        }
+    }
+
+    // Merge passes, fanIn runs at a time, until one run is left
+    while (runs.size() > 1) {
+        ++result.passes;
+        const bool last = runs.size() <= fanIn;
+        std::vector<RunFile> merged;
+
+        for (size_t first = 0; first < runs.size(); first += fanIn) {
+            const std::vector<RunFile> group(runs.begin() + first,
+                                             runs.begin() + std::min(first + fanIn, runs.size()));
+            if (group.size() == 1) {
+                merged.push_back(group[0]);
+                continue;
+            }
+
+            const uint32_t id = nextId++;
+            RunFile out{ id, 0, last ? fs::path(output) : spill.path(id) };
+            Event event{ Event::MERGE_STARTED, result.passes, out.id, 0, {}, last };
+            for (const RunFile& run : group) {
+                out.keys += run.keys;
+                event.inputs.push_back(run.id);
+            }
+            event.keys = out.keys;
+            if (observer)
+                observer(event);
+
+            std::string error;
+            if (!mergeRuns(reads, writes, group, out.path, bufferKeys, options.cancel, error))
+                return fail(error);
+            for (const RunFile& run : group)
+                fs::remove(run.path, ec);
+
+            event.kind = Event::MERGE_FINISHED;
+            if (observer)
+                observer(event);
+            merged.push_back(std::move(out));
+        }
+        runs = std::move(merged);
+    }
+
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
@@ -0,0 +1,146 @@
+/**
+ * frameexporter.cpp
+ *
+ * This file implements the FrameExporter class: the frame queue, the
+ * feeder thread and the parallel encoding of each batch.
+ */
+#include "frameexporter.h"
+#include "workstealingpool.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+FrameExporter::FrameExporter(const QString& path, Format format)
+    : m_path(path), m_format(format)
+{
+    if (format == RAW_VIDEO) {
+        m_raw = std::fopen(QFile::encodeName(path).constData(), "wb");
+        if (!m_raw) {
+            m_error = QString("Cannot write %1").arg(path);
+            return;
+        }
+    }
+    m_feeder = std::thread([this] { feed(); });
+}
+
+FrameExporter::~FrameExporter()
+{
+    finish();
+}
+
+QString FrameExporter::framePath(const QString& path, uint64_t frame)
+{
+    const QFileInfo info(path);
+    const QString suffix = info.suffix().isEmpty() ? QString("png") : info.suffix();
+    return info.dir().filePath(QString("%1_%2.%3")
+                                   .arg(info.completeBaseName())
+                                   .arg(qulonglong(frame), 6, 10, QChar('0'))
+                                   .arg(suffix));
+}
+
+void FrameExporter::addFrame(QImage frame)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this] { return m_queue.size() < kMaxQueued || !m_error.isEmpty(); });
+    if (!m_error.isEmpty() || !m_feeder.joinable())
+        return;
+    m_queue.push_back(std::move(frame));
+    ++m_added;
+    m_changed.notify_all();
+}
+
+bool FrameExporter::finish()
+{
+    if (m_feeder.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closing = true;
+        }
+        m_changed.notify_all();
+        m_feeder.join();
+    }
+    if (m_raw) {
+        if (std::fclose(m_raw) != 0)
+            fail(QString("Cannot write %1").arg(m_path));
+        m_raw = nullptr;
+    }
+    return error().isEmpty();
+}
+
+QString FrameExporter::error() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+void FrameExporter::fail(const QString& reason)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_error.isEmpty())
+        m_error = reason;
+    m_changed.notify_all();
+}
+
+void FrameExporter::feed()
+{
+    std::vector<QImage> batch;
+    std::vector<QByteArray> encoded;
+    std::unique_ptr<bool[]> written;
+    for (;;) {
+        uint64_t first = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this] { return !m_queue.empty() || m_closing; });
+            if (m_queue.empty() || !m_error.isEmpty())
+                return;
+            batch.assign(std::make_move_iterator(m_queue.begin()),
+                         std::make_move_iterator(m_queue.end()));
+            m_queue.clear();
+            first = m_nextFrame;
+            m_nextFrame += batch.size();
+        }
+        m_changed.notify_all();     // Room in the queue again
+
+        // One job per frame; each writes only its own slot
+        encoded.assign(batch.size(), QByteArray());
+        written.reset(new bool[batch.size()]());
+        WorkStealingPool& pool = WorkStealingPool::shared();
+        pool.run([&] {
+            WorkStealingPool::TaskGroup group;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                pool.spawn(group, [&, i] {
+                    if (m_format == PNG_SEQUENCE) {
+                        written[i] = batch[i].save(framePath(m_path, first + i), "PNG");
+                        return;
+                    }
+                    // Tightly packed rows, whatever the image's line padding
+                    const QImage rgb = batch[i].convertToFormat(QImage::Format_RGB888);
+                    const int row = rgb.width() * 3;
+                    QByteArray& out = encoded[i];
+                    out.resize(row * rgb.height());
+                    for (int y = 0; y < rgb.height(); ++y)
+                        std::memcpy(out.data() + y * row, rgb.constScanLine(y), size_t(row));
+                    written[i] = true;
+                });
+            }
+            pool.wait(group);
+        });
+
+        // The raw stream is written in frame order
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!written[i]) {
+                fail(QString("Cannot write frame %1 of %2").arg(qulonglong(first + i)).arg(m_path));
+                return;
+            }
+            if (m_raw && std::fwrite(encoded[i].constData(), 1, size_t(encoded[i].size()), m_raw)
+                             != size_t(encoded[i].size())) {
+                fail(QString("Cannot write %1").arg(m_path));
+                return;
+            }
+        }
+        batch.clear();
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * labelatlas.cpp
+ *
+ * This file implements the LabelAtlas class which draws block values from
+ * pre-rendered digits.
+ */
+#include "labelatlas.h"
+#include <QFontMetricsF>
+#include <QImage>
+#include <QtMath>
+#include <charconv>
+#include <cmath>
+
+namespace {
+    constexpr qreal kOversample = 2.0;  // Atlas pixels per logical pixel, for zooming in
+    constexpr qreal kPadding = 3.0;     // Logical pixels around each glyph for bold overhang
+    const char kCharacters[] = "0123456789-";
+
+    int glyphIndex(char c)
+    {
+        return c == '-' ? 10 : c - '0';
+    }
+}
+
+LabelAtlas& LabelAtlas::shared()
+{
+    static LabelAtlas atlas([] {
+        QFont f;
+        f.setPointSize(35);
+        f.setBold(true);
+        return f;
+    }());
+    return atlas;
+}
+
+LabelAtlas::LabelAtlas(const QFont& font)
+{
+    const QFontMetricsF metrics(font);
+    const qreal cellHeight = metrics.height() + 2 * kPadding;
+
+    // Lay the glyphs out in one row, each in a padded cell of its own
+    qreal width = 0;
+    for (int i = 0; i < kGlyphs; ++i) {
+        m_advance[i] = metrics.horizontalAdvance(QChar(kCharacters[i]));
+        width += m_advance[i] + 2 * kPadding;
+    }
+
+    QImage image(int(std::ceil(width * kOversample)), int(std::ceil(cellHeight * kOversample)),
+                 QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    painter.scale(kOversample, kOversample);
+    painter.setFont(font);
+    painter.setPen(Qt::black);
+    qreal x = 0;
+    for (int i = 0; i < kGlyphs; ++i) {
+        const qreal cellWidth = m_advance[i] + 2 * kPadding;
+        painter.drawText(QPointF(x + kPadding, kPadding + metrics.ascent()),
+                         QString(QChar(kCharacters[i])));
+        m_cells[i] = QRectF(x * kOversample, 0, cellWidth * kOversample,
+                            cellHeight * kOversample);
+        x += cellWidth;
+    }
+    painter.end();
+
+    m_pixmap = QPixmap::fromImage(image);
+}
+
+qreal LabelAtlas::width(int value) const
+{
+    char text[16];
+    const char* end = std::to_chars(text, text + sizeof(text), value).ptr;
+
+    qreal width = 0;
+    for (const char* c = text; c != end; ++c)
+        width += m_advance[glyphIndex(*c)];
+    return width;
+}
+
+void LabelAtlas::append(std::vector<QPainter::PixmapFragment>& out, const QPointF& centre,
+                        int value, qreal rotation, qreal scale) const
+{
+    char text[16];
+    const char* end = std::to_chars(text, text + sizeof(text), value).ptr;
+
+    // Each glyph is placed at its own centre, turned with the label
+    const qreal radians = qDegreesToRadians(rotation);
+    const qreal cosine = std::cos(radians);
+    const qreal sine = std::sin(radians);
+    qreal x = -width(value) / 2;
+    for (const char* c = text; c != end; ++c) {
+        const int g = glyphIndex(*c);
+        const qreal offset = (x + m_advance[g] / 2) * scale;
+        out.push_back(QPainter::PixmapFragment::create(
+            centre + QPointF(offset * cosine, offset * sine), m_cells[g],
+            scale / kOversample, scale / kOversample, rotation));
+        x += m_advance[g];
+    }
+}
+
+void LabelAtlas::draw(QPainter* painter, const std::vector<QPainter::PixmapFragment>& fragments) const
+{
+    if (fragments.empty())
+        return;
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    painter->drawPixmapFragments(fragments.data(), int(fragments.size()), m_pixmap);
+}
+
+void LabelAtlas::draw(QPainter* painter, const QPointF& centre, int value) const
+{
+    std::vector<QPainter::PixmapFragment> fragments;
+    fragments.reserve(12);
+    append(fragments, centre, value);
+    draw(painter, fragments);
+}
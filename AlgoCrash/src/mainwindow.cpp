@@ -7,6 +7,7 @@
  * Checked by: [Yen yee tan]
  */
 #include "mainwindow.h"
+#include "frameexporter.h"
 #include "ui_mainwindow.h"
 #include <QResizeEvent>
 #include <QPushButton>
@@ -15,15 +16,49 @@
 #include <cstdlib>  // for rand
 #include <ctime>    // for time
 #include <QInputDialog>
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QLineEdit>
+#include <iterator>
+#include <climits>
+#include <QSignalBlocker>
+#include <QCheckBox>
+#include <QWheelEvent>
+#include <QMetaObject>
+#include <QCoreApplication>
+#include <algorithm>
+#include <chrono>
 
 static const b2Vec2 kGravity{0.0f, -10.0f};
+static const size_t kMaxBlocks = 500;    // More blocks than this would not fit the view
+static const size_t kMaxBatchedBlocks = 5000;   // Cap when one item draws them all
+static const size_t kMaxArrayKeys = size_t(1) << 20;    // Cap for the headless array view
+static const size_t kMaxQuadraticKeys = 4096;   // ... when the algorithm is slow to step
+static const QRectF kSceneRect(-400, -600, 800, 1200);  // Scene around the first blocks
+static const int kTurboInterval = 16;    // ms per turbo tick, one frame at 60 FPS
+static const int kFrameInterval = 16;    // ms per simTimer frame, and per recorded frame
+static const std::chrono::microseconds kTurboBudget(8000);  // Leaves half the frame to drawing
+
+/**
+ * Checks if an algorithm is held to kMaxQuadraticKeys: a quadratic one
+ * would never finish its run, and a parallel one runs and traces the
+ * whole sort, uncancellably, before its first step
+ *
+ * @param a The algorithm
+ * @return True if the array is capped for it
+ */
+static bool isSlowToStep(SortingController::Algorithm a)
+{
+    return SortEngine::isQuadratic(a) || SortEngine::isParallel(a);
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
     ui(new Ui::MainWindow),
-    world(new b2World(kGravity)), // Gravity
+    world(new PhysicsWorld(kGravity)), // Gravity
+    m_blockPool(new BlockPool(world)),
     m_rng(std::random_device{}()),
     m_offsetDist(-0.1f, 0.1f),
     m_heightDist(4.0f, 5.0f)
@@ -32,28 +67,27 @@ MainWindow::MainWindow(QWidget *parent)
 
     // Set initial interval to match slider value
     sortTimer = new QTimer(this);
-    int sliderValue = ui->speedSlider->value();
-    int adjustedInterval = std::max(50, 1000 - sliderValue);  // 1000 or a max value depending on your slider
-    sortTimer->setInterval(adjustedInterval);
+    updateSortTimer();
 
-    connect(ui->speedSlider, &QSlider::valueChanged, this, [this](int newValue) {
-        int invertedInterval = std::max(50, 1000 - newValue); // Invert logic
-        sortTimer->setInterval(invertedInterval);
-        ui->speedSlider->setToolTip(QString("Speed: %1 ms per step").arg(invertedInterval));
+    connect(ui->speedSlider, &QSlider::valueChanged, this, &MainWindow::updateSortTimer);
+    connect(ui->turboCheckBox, &QCheckBox::toggled, this, &MainWindow::updateSortTimer);
+    connect(ui->batchCheckBox, &QCheckBox::toggled, this, &MainWindow::setBatchedRendering);
+    connect(ui->partialRepaintCheckBox, &QCheckBox::toggled, this, &MainWindow::setPartialRepaint);
+    connect(ui->physicsThreadCheckBox, &QCheckBox::toggled, this, [this](bool threaded) {
+        world->setThreaded(threaded);
     });
 
-    // Now wire this same timer to actually run the sort step
+    // Now wire this same timer to actually run the sort step. A tick that
+    // comes while a swap still animates is held back and run by the sim
+    // timer the moment the blocks stop, instead of waiting a whole tick.
     connect(sortTimer, &QTimer::timeout, this, [this]() {
-        // Each time the timer “ticks,” do one sort step:
-        if (!sortController.step()) {
-            // If sortController.step() returns false, the sort is done.
-            sortTimer->stop();
-            ui->sortButton->setText("Start Sort");
-            sortedLabel->setVisible(true);
+        if (sortController.isAnimating()) {
+            m_stepDeferred = true;
+            return;
         }
-        // And always update the labels:
-        updateStatistics();
+        runSortStep();
     });
+    sortController.animatingCallback = [this]() { return world->isAnimating(); };
 
     /* ── Algorithm selector ─────────────────────────── */
     connect(ui->algorithmComboBox,
@@ -65,11 +99,27 @@ MainWindow::MainWindow(QWidget *parent)
                 sortTimer->stop();
                 ui->sortButton->setText("Start Sort");
 
-                // Set algorithm
-                sortController.setAlgorithm(
-                    idx == 0 ? SortingController::BUBBLE :
-                        idx == 1 ? SortingController::SELECTION :
-                        SortingController::INSERTION);
+                // Set algorithm (combo box order differs from the enum)
+                static const SortingController::Algorithm kComboAlgorithms[] = {
+                    SortingController::BUBBLE,
+                    SortingController::SELECTION,
+                    SortingController::INSERTION,
+                    SortingController::QUICK,
+                    SortingController::MERGE,
+                    SortingController::HEAP,
+                    SortingController::SHELL,
+                    SortingController::BITONIC,
+                    SortingController::ODD_EVEN,
+                    SortingController::ODD_EVEN_MERGE,
+                    SortingController::PARALLEL_MERGE,
+                    SortingController::PARALLEL_QUICK,
+                };
+                if (idx < 0 || idx >= int(std::size(kComboAlgorithms)))
+                    return;
+                capArrayFor(kComboAlgorithms[idx]);
+                sortController.setAlgorithm(kComboAlgorithms[idx]);
+                if (m_arrayMode)
+                    m_arrayView->reset();
 
                 // Hide sorted label and update stats
                 sortedLabel->setVisible(false);
@@ -102,6 +152,89 @@ MainWindow::MainWindow(QWidget *parent)
                         "<b>Complexity:</b> O(n²)\n<b>Stable:</b> Yes\n<b>Intuition:</b> Like sorting playing cards."
                         );
                     break;
+                case 3:
+                    ui->algorithmExplanationBrowser->setText(
+                        "⚡ <b>Quick Sort</b>\n\n"
+                        "• Picks a pivot (here: a random element)\n"
+                        "• Moves smaller elements to its left, the rest to its right\n"
+                        "• Repeats on both sides independently\n\n"
+                        "<b>Complexity:</b> O(n log n) average, O(n²) worst\n<b>Stable:</b> No\n<b>Intuition:</b> Divide around a pivot, then conquer."
+                        );
+                    break;
+                case 4:
+                    ui->algorithmExplanationBrowser->setText(
+                        "🔀 <b>Merge Sort</b>\n\n"
+                        "• Treats every element as a sorted run of length 1\n"
+                        "• Merges neighbouring runs into runs twice as long\n"
+                        "• Stops when a single run is left\n\n"
+                        "<b>Complexity:</b> O(n log n)\n<b>Stable:</b> Yes\n<b>Intuition:</b> Zip two sorted piles together."
+                        );
+                    break;
+                case 5:
+                    ui->algorithmExplanationBrowser->setText(
+                        "⛰ <b>Heap Sort</b>\n\n"
+                        "• Arranges the elements into a max-heap\n"
+                        "• Swaps the largest (the root) to the end\n"
+                        "• Restores the heap on the rest and repeats\n\n"
+                        "<b>Complexity:</b> O(n log n)\n<b>Stable:</b> No\n<b>Intuition:</b> Keep pulling the biggest off the top."
+                        );
+                    break;
+                case 6:
+                    ui->algorithmExplanationBrowser->setText(
+                        "🐚 <b>Shell Sort</b>\n\n"
+                        "• Runs insertion sort on elements far apart (gap)\n"
+                        "• Shrinks the gap (…, 40, 13, 4, 1) each round\n"
+                        "• The final gap-1 pass finishes an almost sorted array\n\n"
+                        "<b>Complexity:</b> about O(n^1.5)\n<b>Stable:</b> No\n<b>Intuition:</b> Move far-off elements early with big jumps."
+                        );
+                    break;
+                case 7:
+                    ui->algorithmExplanationBrowser->setText(
+                        "🕸 <b>Bitonic Sort</b>\n\n"
+                        "• A sorting network: a fixed schedule of compare-exchanges\n"
+                        "• Each step is one layer of disjoint pairs, all swapped at once\n"
+                        "• Merges bitonic runs of 2, 4, 8, … elements\n\n"
+                        "<b>Complexity:</b> O(n log² n) work, O(log² n) layers\n<b>Stable:</b> No\n<b>Intuition:</b> Every pair in a layer could be handled by its own core."
+                        );
+                    break;
+                case 8:
+                    ui->algorithmExplanationBrowser->setText(
+                        "🪜 <b>Odd-Even Transposition Sort</b>\n\n"
+                        "• Alternates between comparing pairs (0,1),(2,3),… and (1,2),(3,4),…\n"
+                        "• All pairs of a layer are compare-exchanged at once\n"
+                        "• n layers always suffice\n\n"
+                        "<b>Complexity:</b> O(n²) work, O(n) layers\n<b>Stable:</b> Yes\n<b>Intuition:</b> Bubble sort with every neighbour pair working in parallel."
+                        );
+                    break;
+                case 9:
+                    ui->algorithmExplanationBrowser->setText(
+                        "🧬 <b>Odd-Even Merge Sort</b>\n\n"
+                        "• Batcher's sorting network built from odd-even merges\n"
+                        "• Each step is one layer of disjoint pairs, all swapped at once\n"
+                        "• Uses fewer comparators than bitonic sort\n\n"
+                        "<b>Complexity:</b> O(n log² n) work, O(log² n) layers\n<b>Stable:</b> No\n<b>Intuition:</b> Merge the even and odd halves, then fix up neighbours."
+                        );
+                    break;
+                case 10:
+                    ui->algorithmExplanationBrowser->setText(
+                        "🧵 <b>Parallel Merge Sort</b>\n\n"
+                        "• Splits the range in half; an idle core may steal one half\n"
+                        "• Small ranges are sorted by the core that holds them\n"
+                        "• Each merge runs once both halves are done\n"
+                        "• Blocks are tinted by the core that last touched them\n\n"
+                        "<b>Complexity:</b> O(n log n) work\n<b>Stable:</b> Yes\n<b>Intuition:</b> Hand half the pile to a friend, merge when they're back."
+                        );
+                    break;
+                case 11:
+                    ui->algorithmExplanationBrowser->setText(
+                        "🧵 <b>Parallel Quick Sort</b>\n\n"
+                        "• Partitions around a pivot like Quick Sort\n"
+                        "• Queues the smaller side for an idle core to steal\n"
+                        "• Keeps partitioning the larger side itself\n"
+                        "• Blocks are tinted by the core that last touched them\n\n"
+                        "<b>Complexity:</b> O(n log n) average work\n<b>Stable:</b> No\n<b>Intuition:</b> Every partition creates work for another core."
+                        );
+                    break;
                 }
             });
 
@@ -116,44 +249,75 @@ MainWindow::MainWindow(QWidget *parent)
     // Set up graphics scene
     scene = new QGraphicsScene(this);
     ui->graphicsView->setScene(scene);
-    scene->setSceneRect(-400, -600, 800, 1200);
+    scene->setSceneRect(kSceneRect);
+    m_blockArray = new BlockArrayItem;
+    m_blockArray->setVisible(false);
+    scene->addItem(m_blockArray);
+    m_arrayView = new ArrayViewItem(sortController, QRectF(-400, -300, 800, 900));
+    m_arrayView->setVisible(false);
+    scene->addItem(m_arrayView);
+
+    // The wheel zooms around the cursor and a drag pans; the array view
+    // handles both itself
+    ui->graphicsView->setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+    ui->graphicsView->setDragMode(QGraphicsView::ScrollHandDrag);
+    ui->graphicsView->viewport()->installEventFilter(this);
 
     // Make view resize properly
     ui->graphicsView->setRenderHint(QPainter::Antialiasing);
-    ui->graphicsView->setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+    setPartialRepaint(ui->partialRepaintCheckBox->isChecked());
     ui->graphicsView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     ui->graphicsView->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 
-    // Add invisible ground
-    b2BodyDef groundDef;
-    groundDef.position.Set(0.0f, -6.0f);
-    b2Body* ground = world->CreateBody(&groundDef);
-
-    b2PolygonShape groundShape;
-    groundShape.SetAsBox(50.0f, 1.0f);
-
-    b2FixtureDef groundFixtureDef;
-    groundFixtureDef.shape = &groundShape;
-    groundFixtureDef.friction = 0.8f; // Higher friction to slow down blocks
-    ground->CreateFixture(&groundFixtureDef);
-
-    // Add initial blocks
-    spawnInitialBlocks({5, 3, 8, 1, 4});
+    // Add invisible ground, wide enough for every slot a batched row can use
+    const float groundLeft = PhysicsBlock::slotX(0) - 5.0f;
+    const float groundRight = PhysicsBlock::slotX(kMaxBatchedBlocks) + 5.0f;
+    world->addGround(b2Vec2((groundLeft + groundRight) / 2, -6.0f),
+                     (groundRight - groundLeft) / 2, 1.0f);
 
-    // Set up the sorting controller
-    sortController.setBlocks(blocks);
+    // Add initial blocks and set up the sorting controller
+    showValues(datasetValues());
     sortController.statusCallback = [this](const QString& msg) {
         ui->explanationLabel->setText(msg);
     };
-    // Timer to simulate Box2D world
+    // Timer to simulate Box2D world, or only to show it when it is stepped
+    // on a thread of its own
     simTimer = new QTimer(this);
     connect(simTimer, &QTimer::timeout, this, [=]() {
-        world->Step(1.0f / 60.0f, 6, 2);
-        for (PhysicsBlock* block : blocks)
-            block->syncWithPhysics();
+        // A replay is only decoded and drawn; physics and the sort stay idle
+        if (m_replay) {
+            const double speed = ui->speedSlider->value() / 1000.0;
+            const double last = double(m_replay->frameCount() - 1);
+            m_replayPosition = std::min(last, m_replayPosition
+                                                  + speed * kFrameInterval
+                                                        / std::max(1u, m_replay->periodMs()));
+            showReplayFrame();
+            updateTimeline();
+            return;
+        }
+
+        world->update();
+        syncChangedBlocks();
+        if (!m_unslottedRuns.empty())
+            slotLandedRuns();
+        if (m_batched)
+            m_blockArray->sync(blocks);
+        if (m_arrayMode)
+            m_arrayView->refresh();
+        else if (m_recorder)
+            recordFrame();
+        if (!m_timelineKnown && sortController.isLengthKnown())
+            updateTimeline();
+        if (m_stepDeferred && !sortController.isAnimating()) {
+            m_stepDeferred = false;
+            if (sortTimer->isActive()) {
+                sortTimer->start();     // The next tick counts from now
+                runSortStep();
+            }
+        }
         updateButtonStates();
     });
-    simTimer->start(16); // ~60 FPS
+    simTimer->start(kFrameInterval); // ~60 FPS
 
     // Connect UI buttons
     connect(ui->stepForwardButton, &QPushButton::clicked, this, &MainWindow::onStepForwardButtonClicked);
@@ -163,10 +327,22 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->resetButton, &QPushButton::clicked, this, &MainWindow::onResetButtonClicked);
     connect(ui->customizeButton, &QPushButton::clicked,
             this, &MainWindow::onCustomizeButtonClicked);
+    connect(ui->loadFileButton, &QPushButton::clicked,
+            this, &MainWindow::onLoadFileButtonClicked);
+    connect(ui->externalSortButton, &QPushButton::clicked,
+            this, &MainWindow::onExternalSortButtonClicked);
+    connect(ui->exportButton, &QPushButton::clicked,
+            this, &MainWindow::onExportButtonClicked);
+    connect(ui->datasetComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onResetButtonClicked);
+    connect(ui->timelineSlider, &QSlider::valueChanged,
+            this, &MainWindow::onTimelineValueChanged);
+    connect(ui->recordCheckBox, &QCheckBox::toggled, this, &MainWindow::onRecordToggled);
+    connect(ui->replayButton, &QPushButton::clicked, this, &MainWindow::onReplayButtonClicked);
 
     // Trigger algorithm description update on startup
     int currentIdx = ui->algorithmComboBox->currentIndex();
-    ui->algorithmComboBox->setCurrentIndex((currentIdx + 1) % 3);  // Change to a different one temporarily
+    ui->algorithmComboBox->setCurrentIndex((currentIdx + 1) % ui->algorithmComboBox->count());  // Change to a different one temporarily
     ui->algorithmComboBox->setCurrentIndex(currentIdx);           // Then back to original
 
 
@@ -180,42 +356,211 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // Results posted by a running external sort are dropped with this window
+    m_cancelExternalSort = true;
+    if (m_externalSortThread.joinable())
+        m_externalSortThread.join();
+    clearBlocks();      // Batched blocks are not in the scene, so it would not delete them
+    delete m_blockPool;
     delete ui;
-    delete world;
+    delete world;   // Joins the physics thread
 }
 
 void MainWindow::spawnInitialBlocks(const std::vector<int>& values)
 {
-    float startX = -3.0f;
-    float spacing = 1.5f;
-
     for (size_t i = 0; i < values.size(); ++i)
     {
         float randomXOffset = m_offsetDist(m_rng);
-        float x = startX + i * spacing + randomXOffset;
+        float x = PhysicsBlock::slotX(i) + randomXOffset;
 
         float randomHeight = m_heightDist(m_rng);
 
-        PhysicsBlock* block = new PhysicsBlock(world, x, randomHeight, values[i]);
-        scene->addItem(block);
+        PhysicsBlock* block = m_blockPool->acquire(x, randomHeight, values[i]);
+        addBlockItem(block);
         blocks.push_back(block);
     }
 }
 
+void MainWindow::showValues(std::vector<int> values)
+{
+    closeReplay();
+    clearBlocks();
+    setArrayMode(values.size() > kMaxBatchedBlocks);
+    if (m_arrayMode) {
+        values.resize(std::min(values.size(), maxValues()));
+        sortController.setKeys(std::move(values));
+        m_arrayView->reset();
+    } else {
+        if (values.size() > kMaxBlocks)
+            setBatchedRendering(true);  // Too many items for the scene otherwise
+        spawnInitialBlocks(values);
+        sortController.setBlocks(blocks);
+
+        // Kept so that a reset to the same values can drop them again
+        m_spawnState = world->saveState();
+        m_spawnValues = std::move(values);
+    }
+    fitScene();
+}
+
+void MainWindow::setArrayMode(bool array)
+{
+    m_arrayMode = array;
+    m_arrayView->setVisible(array);
+    m_blockArray->setVisible(m_batched && !array);
+    ui->graphicsView->setDragMode(array ? QGraphicsView::NoDrag
+                                        : QGraphicsView::ScrollHandDrag);
+}
+
+void MainWindow::fitScene()
+{
+    // Widen the scene to the whole row of blocks
+    QRectF rect = kSceneRect;
+    if (!m_arrayMode && !blocks.empty()) {
+        const qreal left = (PhysicsBlock::slotX(0) - 1) * kPixelsPerMeter;
+        const qreal right = (PhysicsBlock::slotX(blocks.size() - 1) + 1) * kPixelsPerMeter;
+        rect |= QRectF(left, kSceneRect.top(), right - left, kSceneRect.height());
+    }
+    scene->setSceneRect(rect);
+    ui->graphicsView->fitInView(rect, Qt::KeepAspectRatio);
+}
+
+size_t MainWindow::maxValues() const
+{
+    return isSlowToStep(sortController.algorithm()) ? kMaxQuadraticKeys : kMaxArrayKeys;
+}
+
+void MainWindow::capArrayFor(SortingController::Algorithm algorithm)
+{
+    // A quadratic algorithm over a million keys would never finish its run
+    if (!m_arrayMode || !isSlowToStep(algorithm)
+        || sortController.size() <= kMaxQuadraticKeys)
+        return;
+
+    std::vector<int> keys(kMaxQuadraticKeys);
+    for (size_t i = 0; i < keys.size(); ++i)
+        keys[i] = sortController.valueAt(i);
+    sortController.setKeys(std::move(keys));
+    const QString why = SortEngine::isParallel(algorithm) ? "traces its whole run before the first step"
+                                                          : "takes quadratic time";
+    ui->explanationLabel->setText(QString("Only the first %1 keys are kept: %2 %3.")
+                                      .arg(kMaxQuadraticKeys).arg(SortEngine::name(algorithm)).arg(why));
+}
+
+void MainWindow::clearBlocks()
+{
+    for (PhysicsBlock* block : blocks) {
+        removeBlockItem(block);
+        m_blockPool->release(block);
+    }
+    blocks.clear();
+    m_unslottedRuns.clear();
+    m_showingRuns = false;
+    m_spawnState.clear();
+    m_spawnValues.clear();
+}
+
+void MainWindow::addBlockItem(PhysicsBlock* block)
+{
+    const PhysicsWorld::BodyId id = block->bodyId();
+    if (id >= m_blockOfBody.size())
+        m_blockOfBody.resize(id + 1);
+    m_blockOfBody[id] = block;
+
+    // Batched blocks stay out of the scene; m_blockArray draws them
+    if (!m_batched)
+        scene->addItem(block);
+}
+
+void MainWindow::removeBlockItem(PhysicsBlock* block)
+{
+    const PhysicsWorld::BodyId id = block->bodyId();
+    if (id < m_blockOfBody.size() && m_blockOfBody[id] == block)
+        m_blockOfBody[id] = nullptr;
+
+    if (block->scene())
+        scene->removeItem(block);
+}
+
+void MainWindow::syncChangedBlocks()
+{
+    // Bodies still moving stay listed until they rest, so their blending
+    // is redone every frame even without a new snapshot
+    for (PhysicsWorld::BodyId id : world->snapshot().changed) {
+        if (id < m_blockOfBody.size() && m_blockOfBody[id])
+            m_blockOfBody[id]->syncWithPhysics();
+    }
+}
+
+void MainWindow::setPartialRepaint(bool partial)
+{
+    // Blocks only report a change when they moved, turned or recoloured, so
+    // the bounding rect of the changes is all that needs drawing
+    ui->graphicsView->setViewportUpdateMode(partial
+                                                ? QGraphicsView::BoundingRectViewportUpdate
+                                                : QGraphicsView::FullViewportUpdate);
+}
+
+void MainWindow::setBatchedRendering(bool batched)
+{
+    if (batched == m_batched)
+        return;
+    m_batched = batched;
+    for (PhysicsBlock* block : blocks) {
+        if (!batched)
+            scene->addItem(block);
+        else if (block->scene())
+            scene->removeItem(block);
+    }
+    m_blockArray->setVisible(batched);
+    if (batched)
+        m_blockArray->sync(blocks);
+
+    const QSignalBlocker blocker(ui->batchCheckBox);
+    ui->batchCheckBox->setChecked(batched);
+}
+
+std::vector<int> MainWindow::datasetValues() const
+{
+    // The first entry is the fixed example, the rest follow DatasetGenerator
+    const int idx = ui->datasetComboBox->currentIndex();
+    if (idx <= 0 || idx > DatasetGenerator::kDistributionCount)
+        return {5, 3, 8, 1, 4};
+
+    const auto distribution = static_cast<DatasetGenerator::Distribution>(idx - 1);
+    const uint64_t seed = uint64_t(ui->seedSpinBox->value());
+    const uint64_t count = std::min<uint64_t>(ui->sizeSpinBox->value(), maxValues());
+    return DatasetGenerator(distribution, count, seed).generate();
+}
+
+void MainWindow::updateSortTimer()
+{
+    if (ui->turboCheckBox->isChecked()) {
+        sortTimer->setInterval(kTurboInterval);
+        ui->speedSlider->setToolTip(QString("Turbo: up to %1 steps per frame").arg(turboSteps()));
+    } else {
+        int invertedInterval = std::max(50, 1000 - ui->speedSlider->value()); // Invert logic
+        sortTimer->setInterval(invertedInterval);
+        ui->speedSlider->setToolTip(QString("Speed: %1 ms per step").arg(invertedInterval));
+    }
+}
+
+size_t MainWindow::turboSteps() const
+{
+    // Doubles every tenth of the slider: 1 step per frame up to about a million
+    const QSlider* slider = ui->speedSlider;
+    const int range = std::max(1, slider->maximum() - slider->minimum());
+    return size_t(1) << (20 * (slider->value() - slider->minimum()) / range);
+}
+
 void MainWindow::onStepForwardButtonClicked()
 {
     // sortController.step();
     // updateStatistics();
 
-    world->SetGravity(b2Vec2(0.0f, 0.0f));
-    for (PhysicsBlock* block : blocks) {
-        b2Body* b = block->getBody();
-        b2Vec2 p = b->GetPosition();
-        b->SetTransform(p, 0.0f);
-        b->SetType(b2_staticBody);
-        b->SetLinearVelocity(b2Vec2_zero);
-        b->SetAngularVelocity(0.0f);
-    }
+    world->setGravity(b2Vec2(0.0f, 0.0f));
+    for (PhysicsBlock* block : blocks)
+        block->freeze();
 
     // Then start the next step.
     if (!sortController.step()) {
@@ -233,16 +578,10 @@ void MainWindow::onSortButtonClicked()
         ui->sortButton->setText(
             "Continue Sort");
     } else {
-        world->SetGravity(b2Vec2(0.0f, 0.0f));
-
-        for (PhysicsBlock* block : blocks) {
-            b2Body* b = block->getBody();
-            b2Vec2 p = b->GetPosition();
-            b->SetTransform(p, 0.0f);
-            b->SetType(b2_staticBody);
-            b->SetLinearVelocity(b2Vec2_zero);
-            b->SetAngularVelocity(0.0f);
-        }
+        world->setGravity(b2Vec2(0.0f, 0.0f));
+
+        for (PhysicsBlock* block : blocks)
+            block->freeze();
 
         sortTimer->start();  // 1 s per step
         ui->sortButton->setText("Pause Sort");
@@ -253,25 +592,20 @@ void MainWindow::onSortButtonClicked()
 void MainWindow::onResetButtonClicked()
 {
     sortedLabel->setVisible(false);
-    world->SetGravity(b2Vec2(0.0f, -10.0f));
+    world->setGravity(b2Vec2(0.0f, -10.0f));
 
     // Stop sorting
     sortTimer->stop();
     ui->sortButton->setText("Start Sort");
 
-    // Clear existing blocks
-    for (PhysicsBlock* block : blocks) {
-        scene->removeItem(block);
-        world->DestroyBody(block->getBody());
-        delete block;
-    }
-    blocks.clear();
-
-    // Create new blocks
-    spawnInitialBlocks({5, 3, 8, 1, 4});
-
-    // Reset the sorting controller
-    sortController.setBlocks(blocks);
+    // The same values again are dropped again from where they were spawned;
+    // only new values get new blocks
+    std::vector<int> values = datasetValues();
+    if (!m_arrayMode && !m_spawnState.empty() && values == m_spawnValues
+        && world->restoreState(m_spawnState))
+        sortController.setBlocks(blocks);
+    else
+        showValues(std::move(values));
     sortController.statusCallback = [this](const QString& msg) {
         ui->explanationLabel->setText(msg);
     };
@@ -284,7 +618,7 @@ void MainWindow::onResetButtonClicked()
 
 void MainWindow::onCustomizeButtonClicked()
 {
-    world->SetGravity(kGravity);
+    world->setGravity(kGravity);
     bool ok;
     QString text = QInputDialog::getText(
         this,
@@ -297,74 +631,517 @@ void MainWindow::onCustomizeButtonClicked()
     if (!ok || text.isEmpty())
         return;
 
-    // --- New parsing & validation ---
-    QStringList parts = text.split(",", Qt::SkipEmptyParts);
-    std::vector<int> values;
-    QStringList invalidTokens;
-
-    for (const QString& part : parts) {
-        QString token = part.trimmed();
-        bool   numOk  = false;
-        int    val    = token.toInt(&numOk);
-        if (numOk) {
-            values.push_back(val);
-        } else {
-            invalidTokens.append(token);
-        }
+    const QByteArray bytes = text.toUtf8();
+    DatasetLoader::Result result =
+        DatasetLoader::parse(bytes.constData(), size_t(bytes.size()), DatasetLoader::TEXT);
+    loadValues(result, "Custom data loaded! Click 'Start Sort' to begin.");
+}
+
+void MainWindow::onLoadFileButtonClicked()
+{
+    const QString path = QFileDialog::getOpenFileName(
+        this,
+        "Load Data",
+        QString(),
+        "Text or CSV (*.txt *.csv);;Binary int32 (*.i32 *.bin);;Binary int64 (*.i64);;All files (*)"
+        );
+    if (path.isEmpty())
+        return;
+
+    world->setGravity(kGravity);
+    const std::string file = QFile::encodeName(path).toStdString();
+    DatasetLoader::Result result = DatasetLoader::load(file, DatasetLoader::formatFor(file));
+    if (!result.error.empty()) {
+        QMessageBox::warning(this, "Load Failed", QString::fromStdString(result.error));
+        return;
     }
+    loadValues(result, QString("Loaded %1. Click 'Start Sort' to begin.")
+                           .arg(QFileInfo(path).fileName()));
+}
 
-    if (values.empty()) {
+void MainWindow::loadValues(DatasetLoader::Result& result, const QString& message)
+{
+    if (result.keys.empty()) {
         QMessageBox::warning(
             this,
             "Invalid Input",
-            "No valid integers were entered. Please enter only whole numbers separated by commas."
+            "No valid integers were found. Please enter only whole numbers separated by commas."
             );
         return;
     }
 
-    if (!invalidTokens.isEmpty()) {
-        QMessageBox::information(
-            this,
-            "Some Values Ignored",
-            QString("The following entries were not valid integers "
-                    "and have been ignored:\n%1")
-                .arg(invalidTokens.join(", "))
-            );
+    QString notes = QString::fromStdString(result.summary());
+    const size_t cap = maxValues();
+    if (result.keys.size() > cap) {
+        notes += QString("Only the first %1 of %2 values are shown.\n")
+                     .arg(cap).arg(qulonglong(result.keys.size()));
+        result.keys.resize(cap);
     }
-    // --- End of new validation ---
+    if (!notes.isEmpty())
+        QMessageBox::information(this, "Some Values Ignored", notes);
 
     // Hide “complete” label and reset UI
     sortedLabel->setVisible(false);
     sortTimer->stop();
     ui->sortButton->setText("Start Sort");
 
-    // Clear old blocks...
-    for (PhysicsBlock* block : blocks) {
-        scene->removeItem(block);
-        world->DestroyBody(block->getBody());
-        delete block;
-    }
-    blocks.clear();
-
-    // Spawn with the validated values
-    spawnInitialBlocks(values);
-    sortController.setBlocks(blocks);
+    // Replace the blocks with the validated values
+    showValues(std::move(result.keys));
     sortController.statusCallback = [this](const QString& msg) {
         ui->explanationLabel->setText(msg);
     };
 
-    ui->explanationLabel->setText("Custom data loaded! Click 'Start Sort' to begin.");
+    ui->explanationLabel->setText(message);
+    updateStatistics();
+    updateButtonStates();
+}
+
+void MainWindow::onExternalSortButtonClicked()
+{
+    const QString input = QFileDialog::getOpenFileName(
+        this, "External Sort: Input", QString(), "Binary int32 (*.i32 *.bin);;All files (*)");
+    if (input.isEmpty())
+        return;
+    const QString output = QFileDialog::getSaveFileName(
+        this, "External Sort: Output", QString(), "Binary int32 (*.i32 *.bin)");
+    if (output.isEmpty())
+        return;
+
+    // The runs take over the scene; one block per run
+    sortTimer->stop();
+    ui->sortButton->setText("Start Sort");
+    sortedLabel->setVisible(false);
+    closeReplay();
+    clearBlocks();
+    setArrayMode(false);
+    sortController.setBlocks(blocks);
+    world->setGravity(kGravity);
+    m_runBlocks.clear();
+    m_showingRuns = true;
+    setExternalSortRunning(true);
+    ui->explanationLabel->setText(QString("External sort of %1 started...")
+                                      .arg(QFileInfo(input).fileName()));
+
+    if (m_externalSortThread.joinable())
+        m_externalSortThread.join();
+    m_cancelExternalSort = false;
+    m_externalSortThread = std::thread(
+        [this, in = QFile::encodeName(input).toStdString(),
+         out = QFile::encodeName(output).toStdString(), output] {
+            ExternalSort::Options options;
+            options.cancel = &m_cancelExternalSort;
+            const ExternalSort::Result result = ExternalSort::sortFile(
+                in, out, options, [this](const ExternalSort::Event& e) {
+                    QMetaObject::invokeMethod(this, [this, e] { onExternalSortEvent(e); },
+                                              Qt::QueuedConnection);
+                });
+            QMetaObject::invokeMethod(this, [this, result, output] {
+                onExternalSortFinished(result, output);
+            }, Qt::QueuedConnection);
+        });
+}
+
+void MainWindow::onExternalSortEvent(const ExternalSort::Event& e)
+{
+    switch (e.kind) {
+    case ExternalSort::Event::RUN_WRITTEN: {
+        // A new run drops in at the end of the row
+        PhysicsBlock* block = m_blockPool->acquire(PhysicsBlock::slotX(blocks.size()),
+                                                   m_heightDist(m_rng), int(e.run));
+        addBlockItem(block);
+        blocks.push_back(block);
+        m_runBlocks[e.run] = block;
+        ui->explanationLabel->setText(QString("Run %1 written: %2 keys")
+                                          .arg(e.run).arg(qulonglong(e.keys)));
+        break;
+    }
+
+    case ExternalSort::Event::MERGE_STARTED:
+        for (uint32_t run : e.inputs) {
+            auto it = m_runBlocks.find(run);
+            if (it != m_runBlocks.end())
+                it->second->highlight(true);
+        }
+        ui->explanationLabel->setText(QString("Pass %1: merging %2 runs into %3")
+                                          .arg(e.pass).arg(e.inputs.size())
+                                          .arg(e.final ? QString("the output")
+                                                       : QString("run %1").arg(e.run)));
+        break;
+
+    case ExternalSort::Event::MERGE_FINISHED: {
+        // The merged runs make way for their result, which takes the
+        // place of the first of them
+        size_t slot = blocks.size();
+        for (uint32_t run : e.inputs) {
+            auto found = m_runBlocks.find(run);
+            if (found == m_runBlocks.end())
+                continue;
+            PhysicsBlock* block = found->second;
+            m_runBlocks.erase(found);
+            auto it = std::find(blocks.begin(), blocks.end(), block);
+            if (it == blocks.end())
+                continue;
+            slot = std::min(slot, size_t(it - blocks.begin()));
+            blocks.erase(it);
+            m_unslottedRuns.erase(std::remove(m_unslottedRuns.begin(), m_unslottedRuns.end(), block),
+                                m_unslottedRuns.end());
+            removeBlockItem(block);
+            m_blockPool->release(block);
+        }
+        slot = std::min(slot, blocks.size());
+
+        PhysicsBlock* merged = m_blockPool->acquire(PhysicsBlock::slotX(slot),
+                                                    m_heightDist(m_rng), int(e.run));
+        addBlockItem(merged);
+        blocks.insert(blocks.begin() + slot, merged);
+        m_runBlocks[e.run] = merged;
+        if (e.final)
+            merged->highlight(true, true);
+
+        // The merged block drops straight into its slot. The ones after it
+        // move over, but a move would hold a block still falling in
+        // mid-air, so those are slotted by the sim timer once they land
+        for (size_t i = slot + 1; i < blocks.size(); ++i) {
+            if (std::find(m_unslottedRuns.begin(), m_unslottedRuns.end(), blocks[i])
+                == m_unslottedRuns.end())
+                m_unslottedRuns.push_back(blocks[i]);
+        }
+        slotLandedRuns();
+        break;
+    }
+    }
+}
+
+void MainWindow::slotLandedRuns()
+{
+    size_t kept = 0;
+    for (PhysicsBlock* block : m_unslottedRuns) {
+        if (!block->isResting()) {
+            m_unslottedRuns[kept++] = block;
+            continue;
+        }
+        const auto it = std::find(blocks.begin(), blocks.end(), block);
+        block->moveToPosition(size_t(it - blocks.begin()));
+    }
+    m_unslottedRuns.resize(kept);
+}
+
+void MainWindow::onExternalSortFinished(const ExternalSort::Result& result, const QString& output)
+{
+    if (m_externalSortThread.joinable())
+        m_externalSortThread.join();
+    m_runBlocks.clear();
+    setExternalSortRunning(false);
+
+    if (!result.error.empty()) {
+        ui->explanationLabel->setText("External sort failed.");
+        QMessageBox::warning(this, "External Sort Failed", QString::fromStdString(result.error));
+        return;
+    }
+
+    // A single run is the output itself
+    for (PhysicsBlock* block : blocks)
+        block->highlight(true, true);
+    ui->explanationLabel->setText(
+        QString("Sorted %1 keys into %2: %3 runs, %4 merge passes, %5 s. "
+                "Reset to sort the dataset again.")
+            .arg(qulonglong(result.keys)).arg(QFileInfo(output).fileName())
+            .arg(result.runs).arg(result.passes).arg(result.seconds, 0, 'f', 2));
+}
+
+void MainWindow::onExportButtonClicked()
+{
+    QString filter;
+    const QString path = QFileDialog::getSaveFileName(
+        this, "Export Frames", QString(),
+        "PNG image sequence (*.png);;Raw RGB24 video (*.rgb)", &filter);
+    if (path.isEmpty())
+        return;
+    const auto format = filter.startsWith("Raw") ? FrameExporter::RAW_VIDEO
+                                                 : FrameExporter::PNG_SEQUENCE;
+
+    // Frames show what the view shows, at the view's size rounded down to
+    // even sides as video encoders want
+    const QWidget* viewport = ui->graphicsView->viewport();
+    const QSize size(viewport->width() / 2 * 2, viewport->height() / 2 * 2);
+    const QRectF source = ui->graphicsView->mapToScene(viewport->rect()).boundingRect();
+
+    // Physics is stepped here instead of by the timers: one step per frame,
+    // as fast as frames are rendered
+    sortTimer->stop();
+    simTimer->stop();
+    const bool threaded = world->isThreaded();
+    world->setThreaded(false);
+    world->setGravity(b2Vec2(0.0f, 0.0f));
+    for (PhysicsBlock* block : blocks)
+        block->freeze();
+
+    FrameExporter exporter(path, format);
+    QProgressDialog progress("Exporting frames...", "Cancel", 0,
+                             int(std::min<size_t>(sortController.totalSteps(), INT_MAX)), this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+
+    // A step every sort timer interval, or every frame in turbo mode
+    const int framesPerStep = ui->turboCheckBox->isChecked()
+                                  ? 1
+                                  : std::max(1, sortTimer->interval() / kFrameInterval);
+    const auto started = std::chrono::steady_clock::now();
+    int sinceStep = framesPerStep;
+    while (exporter.error().isEmpty() && !progress.wasCanceled()) {
+        const bool done = sortController.isSortingComplete();
+        if (done && !sortController.isAnimating())
+            break;
+        if (!done && sinceStep >= framesPerStep && !sortController.isAnimating()) {
+            runSortStep();
+            sinceStep = 0;
+        }
+
+        world->stepNow();
+        syncChangedBlocks();
+        if (m_batched)
+            m_blockArray->sync(blocks);
+        if (m_arrayMode)
+            m_arrayView->refresh();
+
+        // A new image per frame: the exporter still holds the earlier ones
+        QImage frame(size, QImage::Format_RGB32);
+        frame.fill(Qt::white);
+        QPainter painter(&frame);
+        painter.setRenderHint(QPainter::Antialiasing);
+        scene->render(&painter, QRectF(frame.rect()), source);
+        painter.end();
+        exporter.addFrame(std::move(frame));
+        ++sinceStep;
+
+        if (exporter.frames() % 8 == 0) {
+            progress.setLabelText(QString("Exporting frame %1...").arg(qulonglong(exporter.frames())));
+            progress.setMaximum(int(std::min<size_t>(sortController.totalSteps(), INT_MAX)));
+            progress.setValue(int(std::min<size_t>(sortController.currentStep(), INT_MAX)));
+        }
+        // setValue() only handles events when the value changes, and a
+        // Cancel click should count before the next frame, not the next step
+        QCoreApplication::processEvents();
+    }
+    const bool written = exporter.finish();
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - started).count();
+    progress.reset();
+
+    world->setThreaded(threaded);
+    simTimer->start();
+    ui->sortButton->setText(sortController.isSortingComplete() ? "Start Sort" : "Continue Sort");
     updateStatistics();
     updateButtonStates();
+    if (!written) {
+        QMessageBox::warning(this, "Export Failed", exporter.error());
+        return;
+    }
+    QString message = QString("Exported %1 frames in %2 s.")
+                          .arg(qulonglong(exporter.frames())).arg(seconds, 0, 'f', 1);
+    if (format == FrameExporter::RAW_VIDEO)
+        message += QString(" Raw RGB24, %1x%2 at 60 fps.").arg(size.width()).arg(size.height());
+    ui->explanationLabel->setText(message);
+}
+
+void MainWindow::setExternalSortRunning(bool running)
+{
+    m_externalSortRunning = running;
+    ui->resetButton->setEnabled(!running);
+    ui->customizeButton->setEnabled(!running);
+    ui->loadFileButton->setEnabled(!running);
+    ui->externalSortButton->setEnabled(!running);
+    ui->replayButton->setEnabled(!running);
+    ui->algorithmComboBox->setEnabled(!running);
+    ui->datasetComboBox->setEnabled(!running);
+    updateButtonStates();
 }
 
 void MainWindow::updateStatistics()
 {
-    int comps = sortController.getComparisonCount();
-    int swaps = sortController.getSwapCount();
+    const SortEngine::Stats& stats = sortController.stats();
 
-    ui->comparisonLabel->setText(QString("Comparisons: %1").arg(comps));
-    ui->swapLabel->setText(QString("Swaps: %1").arg(swaps));
+    ui->comparisonLabel->setText(QString("Comparisons: %1").arg(qulonglong(stats.comparisons)));
+    ui->swapLabel->setText(QString("Swaps: %1").arg(qulonglong(stats.swaps)));
+    ui->movesLabel->setText(QString("Moves: %1").arg(qulonglong(stats.moves)));
+    ui->readsLabel->setText(QString("Reads: %1").arg(qulonglong(stats.reads)));
+    ui->writesLabel->setText(QString("Writes: %1").arg(qulonglong(stats.writes)));
+    ui->cacheMissLabel->setText(QString("Cache misses: %1").arg(qulonglong(stats.cacheMisses)));
+
+    updateTimeline();
+}
+
+void MainWindow::updateTimeline()
+{
+    if (m_replay) {
+        const int total = int(std::min<size_t>(m_replay->frameCount() - 1, INT_MAX));
+        const int current = int(m_replayPosition);
+        QSignalBlocker blocker(ui->timelineSlider);
+        ui->timelineSlider->setEnabled(true);
+        ui->timelineSlider->setMaximum(total);
+        ui->timelineSlider->setValue(current);
+        ui->timelineLabel->setText(QString("Frame %1 / %2").arg(current).arg(total));
+        return;
+    }
+
+    // Until the run is counted the slider cannot seek and only shows progress
+    m_timelineKnown = sortController.isLengthKnown();
+    const int current = int(std::min<size_t>(sortController.currentStep(), INT_MAX));
+    const int total = m_timelineKnown
+                          ? int(std::min<size_t>(sortController.totalSteps(), INT_MAX))
+                          : current;
+
+    // Programmatic updates must not trigger another seek
+    QSignalBlocker blocker(ui->timelineSlider);
+    ui->timelineSlider->setEnabled(m_timelineKnown);
+    ui->timelineSlider->setMaximum(total);
+    ui->timelineSlider->setValue(current);
+    ui->timelineLabel->setText(m_timelineKnown
+                                   ? QString("Step %1 / %2").arg(current).arg(total)
+                                   : QString("Step %1 / counting...").arg(current));
+}
+
+void MainWindow::onTimelineValueChanged(int value)
+{
+    // During a replay the slider picks a frame
+    if (m_replay) {
+        m_replayPosition = value;
+        showReplayFrame();
+        updateTimeline();
+        return;
+    }
+
+    // Scrubbing pauses the automatic sort
+    if (sortTimer->isActive()) {
+        sortTimer->stop();
+        ui->sortButton->setText("Continue Sort");
+    }
+
+    // Blocks are placed directly, so keep gravity off as in stepping
+    world->setGravity(b2Vec2(0.0f, 0.0f));
+    sortController.seek(static_cast<size_t>(value));
+
+    sortedLabel->setVisible(sortController.isSortingComplete());
+    updateStatistics();
+    updateButtonStates();
+}
+
+void MainWindow::onRecordToggled(bool record)
+{
+    if (!record) {
+        if (!m_recorder)
+            return;
+        const uint64_t frames = m_recorder->frames();
+        if (m_recorder->finish())
+            ui->explanationLabel->setText(QString("Recorded %1 frames.").arg(qulonglong(frames)));
+        else
+            QMessageBox::warning(this, "Recording Failed",
+                                 QString::fromStdString(m_recorder->error()));
+        m_recorder.reset();
+        return;
+    }
+
+    const QString path = QFileDialog::getSaveFileName(
+        this, "Record Replay", QString(), "Replay (*.acr)");
+    auto recorder = path.isEmpty()
+                        ? nullptr
+                        : std::make_unique<ReplayWriter>(QFile::encodeName(path).toStdString(),
+                                                         kFrameInterval);
+    if (!recorder || !recorder->error().empty()) {
+        if (recorder)
+            QMessageBox::warning(this, "Recording Failed",
+                                 QString::fromStdString(recorder->error()));
+        const QSignalBlocker blocker(ui->recordCheckBox);
+        ui->recordCheckBox->setChecked(false);
+        return;
+    }
+    m_recorder = std::move(recorder);
+}
+
+void MainWindow::recordFrame()
+{
+    m_replayFrame.resize(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const PhysicsBlock* b = blocks[i];
+        const QPointF pos = b->pos();
+        m_replayFrame[i] = { float(pos.x()), float(pos.y()), float(b->rotation()),
+                             uint32_t(b->brush().color().rgb()), int32_t(b->getValue()) };
+    }
+    m_recorder->addFrame(m_replayFrame);
+}
+
+void MainWindow::onReplayButtonClicked()
+{
+    if (m_replay) {
+        showValues(datasetValues());
+        updateStatistics();
+        updateButtonStates();
+        ui->explanationLabel->setText("Replay stopped.");
+        return;
+    }
+
+    const QString path = QFileDialog::getOpenFileName(
+        this, "Play Replay", QString(), "Replay (*.acr);;All files (*)");
+    if (path.isEmpty())
+        return;
+    auto replay = std::make_unique<ReplayReader>(QFile::encodeName(path).toStdString());
+    if (!replay->error().empty() || replay->frameCount() == 0) {
+        QMessageBox::warning(this, "Replay Failed",
+                             replay->error().empty() ? QString("%1 holds no frames.").arg(path)
+                                                     : QString::fromStdString(replay->error()));
+        return;
+    }
+
+    // The replay takes over the scene; nothing is simulated while it plays
+    sortTimer->stop();
+    ui->sortButton->setText("Start Sort");
+    sortedLabel->setVisible(false);
+    ui->recordCheckBox->setChecked(false);
+    clearBlocks();
+    setArrayMode(false);
+    sortController.setBlocks(blocks);
+    m_replay = std::move(replay);
+    m_replayPosition = 0.0;
+    m_blockArray->setVisible(true);
+    showReplayFrame();
+    scene->setSceneRect(kSceneRect | m_blockArray->boundingRect());
+    ui->graphicsView->fitInView(scene->sceneRect(), Qt::KeepAspectRatio);
+
+    ui->replayButton->setText("Stop Replay");
+    ui->recordCheckBox->setEnabled(false);
+    ui->explanationLabel->setText(QString("Playing %1; the speed slider sets the pace.")
+                                      .arg(QFileInfo(path).fileName()));
+    updateTimeline();
+    updateButtonStates();
+}
+
+void MainWindow::showReplayFrame()
+{
+    if (m_replay->readFrame(size_t(m_replayPosition), m_replayFrame))
+        m_blockArray->sync(m_replayFrame);
+}
+
+void MainWindow::closeReplay()
+{
+    if (!m_replay)
+        return;
+    m_replay.reset();
+    m_blockArray->sync(blocks);     // Drops the replay's blocks
+    m_blockArray->setVisible(m_batched && !m_arrayMode);
+    ui->replayButton->setText("Play Replay...");
+    ui->recordCheckBox->setEnabled(true);
+}
+
+bool MainWindow::eventFilter(QObject* watched, QEvent* event)
+{
+    // Zoom the block scene around the cursor; the array view zooms itself
+    if (event->type() == QEvent::Wheel && !m_arrayMode) {
+        const auto* wheel = static_cast<QWheelEvent*>(event);
+        const qreal factor = std::pow(1.0015, wheel->angleDelta().y());
+        ui->graphicsView->scale(factor, factor);
+        return true;
+    }
+    return QMainWindow::eventFilter(watched, event);
 }
 
 void MainWindow::resizeEvent(QResizeEvent* event)
@@ -379,34 +1156,41 @@ void MainWindow::resizeEvent(QResizeEvent* event)
 
 bool MainWindow::areBlocksSettled() const
 {
-    for (PhysicsBlock* block : blocks) {
-        b2Body* body = block->getBody();
-        if (body->GetType() != b2_staticBody) {
-            return false;
-        }
+    return world->isSettled();
+}
+
+void MainWindow::runSortStep()
+{
+    // Do one sort step, or a batch in turbo mode:
+    const bool running = ui->turboCheckBox->isChecked()
+                             ? sortController.turbo(turboSteps(), kTurboBudget)
+                             : sortController.step();
+    if (!running) {
+        // If the controller returns false, the sort is done.
+        sortTimer->stop();
+        ui->sortButton->setText("Start Sort");
+        sortedLabel->setVisible(true);
     }
-    return true;
+    // And always update the labels:
+    updateStatistics();
 }
 
 void MainWindow::updateButtonStates()
 {
-    bool ready = areBlocksSettled();
+    bool ready = areBlocksSettled() && !m_externalSortRunning && !m_showingRuns && !m_replay;
     bool hasHistory = !sortController.isHistoryEmpty();
     ui->sortButton->setEnabled(ready);
     ui->stepForwardButton->setEnabled(ready);
-    ui->stepBackwardButton->setEnabled(hasHistory);
+    ui->exportButton->setEnabled(ready && !sortController.isSortingComplete());
+    ui->stepBackwardButton->setEnabled(hasHistory && !m_externalSortRunning && !m_replay);
 }
 
 void MainWindow::onStepBackwardButtonClicked()
 {
     // Freeze physics during undo to prevent jitter
-    world->SetGravity(b2Vec2(0.0f, 0.0f));
-    for (PhysicsBlock* block : blocks) {
-        b2Body* body = block->getBody();
-        body->SetType(b2_staticBody);
-        body->SetLinearVelocity(b2Vec2_zero);
-        body->SetAngularVelocity(0.0f);
-    }
+    world->setGravity(b2Vec2(0.0f, 0.0f));
+    for (PhysicsBlock* block : blocks)
+        block->freeze();
 
     if (sortController.restoreState()) {
         updateStatistics();
@@ -417,7 +1201,7 @@ void MainWindow::onStepBackwardButtonClicked()
 
         // Restore gravity after one frame
         QTimer::singleShot(0, [this]() {
-            world->SetGravity(b2Vec2(0.0f, -10.0f));
+            world->setGravity(b2Vec2(0.0f, -10.0f));
         });
     } else {
         ui->explanationLabel->setText("Nothing to undo.");
@@ -0,0 +1,65 @@
+/**
+ * mappedfile.cpp
+ *
+ * This file implements the MappedFile class.
+ */
+#include "mappedfile.h"
+#include <cerrno>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+#if defined(_WIN32)
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        m_error = "cannot open " + path;
+        return;
+    }
+    m_buffer.resize(size_t(in.tellg()));
+    in.seekg(0);
+    if (!in.read(m_buffer.data(), std::streamsize(m_buffer.size()))) {
+        m_error = "cannot read " + path;
+        return;
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        m_error = path + ": " + std::strerror(errno);
+        return;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        m_error = path + ": " + std::strerror(errno);
+    } else if (st.st_size > 0) {
+        void* p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            m_error = path + ": " + std::strerror(errno);
+        } else {
+            // Readers go through the file front to back
+            ::madvise(p, size_t(st.st_size), MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(p);
+            m_size = size_t(st.st_size);
+        }
+    }
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#if !defined(_WIN32)
+    if (m_data)
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
@@ -0,0 +1,229 @@
+/**
+ * parallelsort.cpp
+ *
+ * This file implements the ParallelSort class: the merge sort and
+ * quicksort task bodies and the bookkeeping of finished tasks.
+ */
+#include "parallelsort.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iterator>
+#include <utility>
+
+namespace {
+    using Op = TraceEvent::Op;
+    using Clock = std::chrono::steady_clock;
+
+    struct Context {
+        std::vector<int>& keys;
+        std::vector<int> buffer;            // Scratch for merges, indexed like keys
+        WorkStealingPool& pool;
+        size_t grain;
+        bool trace;
+        Clock::time_point start;
+        std::atomic<uint64_t> sequence{ 0 };
+        std::vector<std::vector<ParallelSort::Task>> done;  // Per worker
+        std::vector<CacheModel> caches;     // Per worker, empty if not modelled
+        WorkStealingPool::TaskGroup group;  // Quicksort tasks
+    };
+
+    ParallelSort::Task begin(Context& c, ParallelSort::Phase phase, size_t lo, size_t hi)
+    {
+        const int worker = c.pool.currentWorker();
+        assert(worker >= 0);
+
+        ParallelSort::Task t;
+        t.phase = phase;
+        t.lo = uint32_t(lo);
+        t.hi = uint32_t(hi);
+        t.worker = uint32_t(worker);
+        t.sequence = c.sequence.fetch_add(1, std::memory_order_relaxed);
+        t.startNs = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 Clock::now() - c.start).count());
+        t.durationNs = 0;
+        return t;
+    }
+
+    void finish(Context& c, ParallelSort::Task& t)
+    {
+        const uint64_t now = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          Clock::now() - c.start).count());
+        t.durationNs = now - t.startNs;
+        c.done[t.worker].push_back(std::move(t));
+    }
+
+    void note(Context& c, ParallelSort::Task& t, Op op, size_t a, size_t b = 0)
+    {
+        const TraceEvent e = { op, uint32_t(a), uint32_t(b) };
+        SortEngine::count(t.stats, e, c.caches.empty() ? nullptr : &c.caches[t.worker]);
+        if (c.trace)
+            t.trace.append(e.op, e.a, e.b);
+    }
+
+    /* Merges [lo, mid) and [mid, hi) through the buffer; events describe
+       the in-place merge like SortEngine's merge sort does. */
+    void mergeRuns(Context& c, ParallelSort::Task& t, size_t lo, size_t mid, size_t hi)
+    {
+        std::vector<int>& k = c.keys;
+        std::copy(k.begin() + lo, k.begin() + mid, c.buffer.begin() + lo);
+
+        size_t out = lo, li = lo, j = mid;
+        while (li < mid && j < hi) {
+            note(c, t, Op::COMPARE, j, out);
+            if (k[j] < c.buffer[li]) {
+                k[out] = k[j];
+                note(c, t, Op::MOVE, j, out);
+                ++j;
+            } else {
+                k[out] = c.buffer[li++];
+            }
+            ++out;
+        }
+        while (li < mid)
+            k[out++] = c.buffer[li++];
+    }
+
+    void mergeSortTask(Context& c, size_t lo, size_t hi)
+    {
+        if (hi - lo <= c.grain) {
+            if (hi - lo < 2)
+                return;
+            ParallelSort::Task t = begin(c, ParallelSort::LEAF, lo, hi);
+            for (size_t width = 1; width < hi - lo; width *= 2)
+                for (size_t left = lo; left + width < hi; left += 2 * width)
+                    mergeRuns(c, t, left, left + width, std::min(left + 2 * width, hi));
+            finish(c, t);
+            return;
+        }
+
+        // Another worker may steal the left half while this one sorts the right
+        const size_t mid = lo + (hi - lo) / 2;
+        WorkStealingPool::TaskGroup halves;
+        c.pool.spawn(halves, [&c, lo, mid] { mergeSortTask(c, lo, mid); });
+        mergeSortTask(c, mid, hi);
+        c.pool.wait(halves);
+
+        ParallelSort::Task t = begin(c, ParallelSort::MERGE, lo, hi);
+        mergeRuns(c, t, lo, mid, hi);
+        finish(c, t);
+    }
+
+    /* A pivot that depends only on the range, so runs are reproducible,
+       and is never the last key, which Hoare partitioning needs */
+    size_t pivotIndex(size_t lo, size_t hi)
+    {
+        uint64_t x = (uint64_t(lo) << 32) ^ hi;
+        x = (x ^ (x >> 33)) * 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        return lo + size_t(x % (hi - lo - 1));
+    }
+
+    /* Hoare partitioning as in SortEngine's quicksort; returns the split
+       point: [lo, split) <= pivot <= [split, hi) */
+    size_t partition(Context& c, ParallelSort::Task& t, size_t lo, size_t hi)
+    {
+        std::vector<int>& k = c.keys;
+        size_t pivot = pivotIndex(lo, hi);
+        note(c, t, Op::FOCUS, pivot);
+
+        size_t i = lo, j = hi - 1;
+        for (;;) {
+            for (;; ++i) {
+                note(c, t, Op::COMPARE, i, pivot);
+                if (!(k[i] < k[pivot]))
+                    break;
+            }
+            for (;; --j) {
+                note(c, t, Op::COMPARE, j, pivot);
+                if (!(k[pivot] < k[j]))
+                    break;
+            }
+            if (i >= j)
+                break;
+
+            std::swap(k[i], k[j]);
+            note(c, t, Op::SWAP, i, j);
+            if (pivot == i)
+                pivot = j;
+            else if (pivot == j)
+                pivot = i;
+            ++i;
+            --j;
+        }
+        return j + 1;
+    }
+
+    void quickSortTask(Context& c, size_t lo, size_t hi)
+    {
+        // Keep the larger side, hand the smaller one to whoever steals it
+        while (hi - lo > c.grain) {
+            ParallelSort::Task t = begin(c, ParallelSort::PARTITION, lo, hi);
+            const size_t split = partition(c, t, lo, hi);
+            finish(c, t);
+
+            if (split - lo < hi - split) {
+                c.pool.spawn(c.group, [&c, lo, split] { quickSortTask(c, lo, split); });
+                lo = split;
+            } else {
+                c.pool.spawn(c.group, [&c, split, hi] { quickSortTask(c, split, hi); });
+                hi = split;
+            }
+        }
+
+        if (hi - lo < 2)
+            return;
+
+        ParallelSort::Task t = begin(c, ParallelSort::LEAF, lo, hi);
+        std::vector<std::pair<size_t, size_t>> ranges = { { lo, hi } };
+        while (!ranges.empty()) {
+            auto [l, h] = ranges.back();
+            ranges.pop_back();
+            if (h - l < 2)
+                continue;
+            const size_t split = partition(c, t, l, h);
+            ranges.emplace_back(l, split);
+            ranges.emplace_back(split, h);
+        }
+        finish(c, t);
+    }
+}
+
+size_t ParallelSort::grain(size_t n, unsigned workers)
+{
+    return std::clamp<size_t>(n / (4 * std::max(1u, workers)), 8, 8192);
+}
+
+ParallelSort::Result ParallelSort::run(SortEngine::Algorithm a, std::vector<int>& keys,
+                                       WorkStealingPool& pool, bool trace, bool modelCache)
+{
+    assert(SortEngine::isParallel(a));
+
+    Context c{ keys, {}, pool, grain(keys.size(), pool.size()), trace, Clock::now(), {}, {}, {}, {} };
+    c.done.resize(pool.size());
+    if (modelCache)
+        c.caches.resize(pool.size());
+
+    if (a == SortEngine::PARALLEL_MERGE) {
+        c.buffer.resize(keys.size());
+        pool.run([&c] { mergeSortTask(c, 0, c.keys.size()); });
+    } else {
+        pool.run([&c] {
+            quickSortTask(c, 0, c.keys.size());
+            c.pool.wait(c.group);
+        });
+    }
+
+    Result result;
+    for (std::vector<Task>& tasks : c.done)
+        std::move(tasks.begin(), tasks.end(), std::back_inserter(result.tasks));
+    std::sort(result.tasks.begin(), result.tasks.end(),
+              [](const Task& l, const Task& r) { return l.sequence < r.sequence; });
+
+    for (const Task& t : result.tasks) {
+        result.stats += t.stats;
+        ++result.stats.events;      // The task's TASK event
+    }
+    return result;
+}
@@ -7,42 +7,39 @@
  * Checked by: [Sidharth Dhumal]
  */
 #include "physicsblock.h"
+#include "labelatlas.h"
+#include <algorithm>
 #include <cmath>
 #include <QBrush>
+#include <QColor>
 #include <QFont>
 
-PhysicsBlock::PhysicsBlock(b2World* world, float x, float y, int value)
-    : m_value(value)
+PhysicsBlock::PhysicsBlock(PhysicsWorld* world, float x, float y, int value)
+    : m_world(world)
+    , m_value(value)
     , m_isMoving(false)
 {
     setRect(-40, -40, 80, 80);
     setBrush(QBrush(Qt::white));
 
-    label = new QGraphicsSimpleTextItem(QString::number(value), this);
-    QFont f = label->font();
-    f.setPointSize(35);
-    f.setBold(true);
-    label->setFont(f);
-    label->setPos(-20, -20);
-
-    b2BodyDef bodyDef;
-    bodyDef.type = b2_dynamicBody;
-    bodyDef.position.Set(x, y);
-    body = world->CreateBody(&bodyDef);
-
-    body->SetLinearDamping(0.5f);
-    body->SetAngularDamping(0.5f);
-
-    b2PolygonShape shape;
-    shape.SetAsBox(0.5f, 0.5f); // 1m x 1m box
-
-    b2FixtureDef fixtureDef;
-    fixtureDef.shape = &shape;
-    fixtureDef.density = 1.0f;
-    fixtureDef.friction = 0.3f;
-    fixtureDef.restitution = 0.7f; // Less bouncing
+    // Snapshots from before the create carry another serial and are ignored
+    m_id = world->createBlock(x, y, m_serial);
+}
 
-    body->CreateFixture(&fixtureDef);
+void PhysicsBlock::respawn(float x, float y, int value)
+{
+    m_id = m_world->createBlock(x, y, m_serial);
+    m_pending = 0;
+    m_isMoving = false;
+    m_resting = false;
+    m_synced = false;
+    m_worker = -1;
+    highlight(false);
+    setValue(value);
+
+    // Shown at the new spawn point until the first snapshot of the body
+    setPos(x * kPixelsPerMeter, -y * kPixelsPerMeter);
+    setRotation(0);
 }
 
 namespace {
@@ -57,59 +54,70 @@ namespace {
     }
 }
 
-void PhysicsBlock::syncWithPhysics()
+bool PhysicsBlock::syncWithPhysics()
 {
-    b2Vec2 pos = body->GetPosition();
-
-    // 1) Handle kinematic “moveToPosition” animation
-    if (m_isMoving) {
-        float dx = m_targetPosition.x - pos.x;
-        if (std::abs(dx) < 0.05f) {
-            // Close enough: snap to target and become static
-            m_isMoving = false;
-            body->SetTransform(m_targetPosition, 0.0f);
-            body->SetType(b2_staticBody);
-            body->SetLinearVelocity(b2Vec2_zero);
-            body->SetAngularVelocity(0.0f);
-        } else {
-            // Slide toward target at kMoveSpeed
-            float vx = (dx > 0 ? 1.0f : -1.0f) * kMoveSpeed;
-            body->SetType(b2_kinematicBody);
-            body->SetLinearVelocity(b2Vec2(vx, 0.0f));
-        }
-        pos = body->GetPosition();  // update after kinematic move
-    }
-
-    // 2) Detect landing: nearly still and below threshold
-    if ((body->GetType() == b2_dynamicBody || body->GetType() == b2_kinematicBody) &&
-        body->GetLinearVelocity().Length() < 0.01f &&
-        pos.y <= kLandingYThreshold)
-    {
-        // Snap to uniform landing level
-        body->SetType(b2_staticBody);
-        body->SetLinearVelocity(b2Vec2_zero);
-        body->SetAngularVelocity(0.0f);
-
-        b2Vec2 landingPos = body->GetPosition();
-        landingPos.y = kLandingYSnap;
-        body->SetTransform(landingPos, 0.0f);
-    }
-
-    // 3) Finally, update the Qt item’s position & rotation
-    QPointF scenePos = worldToScene(pos);
-    setPos(scenePos);
-    setRotation(radToDeg(body->GetAngle()));
+    const PhysicsWorld::Snapshot& snapshot = m_world->snapshot();
+    if (m_id >= snapshot.bodies.size())
+        return false;
+    const PhysicsWorld::Transform& t = snapshot.bodies[m_id];
+
+    // 0) A snapshot of someone else's body, or of ours before its latest
+    //    command or a restore of the world, would undo what the GUI
+    //    already shows
+    if (t.serial != m_serial || snapshot.applied < std::max(m_pending, m_world->lastRestore()))
+        return false;
+    m_isMoving = t.moving;
+    m_resting = t.resting;
+
+    // 1) Blend the last two states; a resting body has both the same
+    const float alpha = m_world->alpha();
+    const b2Vec2 pos(t.prevX + (t.x - t.prevX) * alpha, t.prevY + (t.y - t.prevY) * alpha);
+    const float angle = t.prevAngle + (t.angle - t.prevAngle) * alpha;
+
+    // 2) Update the Qt item’s position & rotation if they changed
+    if (m_synced && pos == m_syncedPos && angle == m_syncedAngle)
+        return false;
+    m_synced = true;
+    m_syncedPos = pos;
+    m_syncedAngle = angle;
+    setPos(worldToScene(pos));
+    setRotation(radToDeg(angle));
+    return true;
 }
 
-void PhysicsBlock::moveToPosition(size_t index)
+float PhysicsBlock::slotX(size_t index)
 {
     float startX = -3.0f;
     float spacing = 1.5f;
-    float targetX = startX + index * spacing;
+    return startX + index * spacing;
+}
 
-    float currentY = body->GetPosition().y;
-    m_targetPosition = b2Vec2(targetX, currentY);
+void PhysicsBlock::moveToPosition(size_t index)
+{
+    m_pending = m_world->moveTo(m_id, slotX(index));
     m_isMoving = true;
+    m_resting = false;
+}
+
+void PhysicsBlock::placeAtPosition(size_t index)
+{
+    m_pending = m_world->placeAt(m_id, slotX(index));
+    m_isMoving = false;
+    m_resting = true;
+
+    // Shown in place at once; the snapshots catch up a step later
+    m_synced = true;
+    m_syncedPos.x = slotX(index);
+    m_syncedAngle = 0.0f;
+    setPos(worldToScene(m_syncedPos));
+    setRotation(0);
+}
+
+void PhysicsBlock::freeze()
+{
+    m_pending = m_world->freeze(m_id);
+    m_isMoving = false;
+    m_resting = true;
 }
 
 void PhysicsBlock::highlight(bool isActive, bool isSorted)
@@ -122,13 +130,32 @@ void PhysicsBlock::highlight(bool isActive, bool isSorted)
     else if (isActive) {
         setBrush(QBrush(Qt::yellow)); // Yellow for active comparison
     }
+    else if (m_worker >= 0) {
+        // Pastel hue per worker, spread around the colour wheel
+        setBrush(QBrush(QColor::fromHsv((m_worker * 67) % 360, 70, 255)));
+    }
     else {
         setBrush(QBrush(Qt::white)); // White = default
     }
 }
 
+void PhysicsBlock::setWorker(int worker)
+{
+    if (worker == m_worker)
+        return;
+    m_worker = worker;
+    highlight(m_activeHighlight, m_sortedHighlight);
+}
+
 void PhysicsBlock::setValue(int newValue)
 {
     m_value = newValue;
-    label->setText(QString::number(newValue));
+    update();
+}
+
+void PhysicsBlock::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
+                         QWidget* widget)
+{
+    QGraphicsRectItem::paint(painter, option, widget);
+    LabelAtlas::shared().draw(painter, rect().center(), m_value);
 }
@@ -0,0 +1,677 @@
+/**
+ * physicsworld.cpp
+ *
+ * This file implements the PhysicsWorld class which owns the Box2D world of
+ * the blocks and steps it, on the GUI thread or on a thread of its own.
+ */
+#include "physicsworld.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+    constexpr uint32_t kStateMagic = 0x53573242;   // "B2WS"
+    constexpr uint32_t kStateVersion = 1;
+    constexpr uint32_t kGroundId = UINT32_MAX;     // Contact partner id of the ground
+
+    void halt(b2Body* body)
+    {
+        body->SetType(b2_staticBody);
+        body->SetLinearVelocity(b2Vec2_zero);
+        body->SetAngularVelocity(0.0f);
+    }
+
+    // Blocks carry their id + 1 as user data; the ground carries none
+    uint32_t idOf(const b2Body* body)
+    {
+        const uintptr_t data = reinterpret_cast<uintptr_t>(body->GetUserData());
+        return data ? uint32_t(data - 1) : kGroundId;
+    }
+
+    template <typename T>
+    void put(std::vector<uint8_t>& out, const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const size_t at = out.size();
+        out.resize(at + sizeof(T));
+        std::memcpy(out.data() + at, &value, sizeof(T));
+    }
+
+    /**
+     * Reads values back in the order put() wrote them, failing past the end
+     */
+    struct StateReader {
+        const std::vector<uint8_t>& in;
+        size_t at = 0;
+        bool ok = true;
+
+        template <typename T>
+        T get()
+        {
+            T value{};
+            if (at + sizeof(T) > in.size()) {
+                ok = false;
+                return value;
+            }
+            std::memcpy(&value, in.data() + at, sizeof(T));
+            at += sizeof(T);
+            return value;
+        }
+    };
+
+    // One solved contact: who touches whom and the impulses of its points
+    struct ContactPoint {
+        uint32_t key;
+        float normalImpulse;
+        float tangentImpulse;
+    };
+}
+
+PhysicsWorld::PhysicsWorld(const b2Vec2& gravity)
+    : m_world(gravity)
+{
+}
+
+PhysicsWorld::~PhysicsWorld()
+{
+    setThreaded(false);
+}
+
+void PhysicsWorld::setThreaded(bool threaded)
+{
+    if (threaded == isThreaded())
+        return;
+    if (threaded) {
+        m_stop = false;
+        m_thread = std::thread([this] { run(); });
+    } else {
+        m_stop = true;
+        m_thread.join();
+    }
+}
+
+bool PhysicsWorld::update()
+{
+    const Clock::time_point now = Clock::now();
+    if (!isThreaded())
+        advance(now);
+
+    // Swap the read buffer for the shared one if that holds a newer snapshot
+    bool fresh = false;
+    if (m_shared.load(std::memory_order_acquire) & kFresh) {
+        m_readIndex = m_shared.exchange(m_readIndex, std::memory_order_acq_rel) & ~kFresh;
+        fresh = true;
+    }
+
+    // Drawing one step behind puts now between the snapshot's two states
+    const float behind = std::chrono::duration<float>(now - snapshot().time).count();
+    m_alpha = std::clamp(behind / kTimeStep, 0.0f, 1.0f);
+    return fresh;
+}
+
+void PhysicsWorld::stepNow()
+{
+    // Live stepping resumes from now rather than catching up afterwards
+    stepOnce();
+    m_simTime = Clock::now();
+    publish();
+    m_readIndex = m_shared.exchange(m_readIndex, std::memory_order_acq_rel) & ~kFresh;
+    m_alpha = 1.0f;
+}
+
+void PhysicsWorld::advance(Clock::time_point now)
+{
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<float>(kTimeStep));
+    int steps = 0;
+    while (m_simTime + period <= now) {
+        if (steps == kMaxCatchUpSteps) {
+            // Too far behind to catch up: let the simulation slow down
+            // rather than spend ever longer frames stepping
+            m_simTime = now;
+            break;
+        }
+        stepOnce();
+        m_simTime += period;
+        ++steps;
+    }
+    if (steps > 0)
+        publish();
+}
+
+void PhysicsWorld::run()
+{
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<float>(kTimeStep));
+    while (!m_stop.load(std::memory_order_relaxed)) {
+        advance(Clock::now());
+        std::this_thread::sleep_until(m_simTime + period);
+    }
+}
+
+uint64_t PhysicsWorld::enqueue(const Command& c)
+{
+    std::lock_guard<std::mutex> lock(m_commandMutex);
+    m_commands.push_back(c);
+    m_issued = m_nextCommand++;
+    return m_issued;
+}
+
+bool PhysicsWorld::isSettled() const
+{
+    const Snapshot& s = snapshot();
+    return s.applied >= m_issued && s.unsettled == 0;
+}
+
+bool PhysicsWorld::isAnimating() const
+{
+    const Snapshot& s = snapshot();
+    return s.applied < m_issued || s.moving > 0;
+}
+
+void PhysicsWorld::addGround(const b2Vec2& centre, float halfWidth, float halfHeight)
+{
+    enqueue({ Command::GROUND, 0, 0, centre.x, centre.y, halfWidth, halfHeight });
+}
+
+PhysicsWorld::BodyId PhysicsWorld::createBlock(float x, float y, uint32_t& serial)
+{
+    BodyId id;
+    if (m_freeIds.empty()) {
+        id = m_nextId++;
+    } else {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+    serial = m_nextSerial++;
+    enqueue({ Command::CREATE, id, serial, x, y, 0, 0 });
+    return id;
+}
+
+void PhysicsWorld::destroyBody(BodyId id)
+{
+    enqueue({ Command::DESTROY, id, 0, 0, 0, 0, 0 });
+    m_freeIds.push_back(id);
+}
+
+uint64_t PhysicsWorld::moveTo(BodyId id, float x)
+{
+    return enqueue({ Command::MOVE_TO, id, 0, x, 0, 0, 0 });
+}
+
+uint64_t PhysicsWorld::placeAt(BodyId id, float x)
+{
+    return enqueue({ Command::PLACE_AT, id, 0, x, 0, 0, 0 });
+}
+
+uint64_t PhysicsWorld::freeze(BodyId id)
+{
+    return enqueue({ Command::FREEZE, id, 0, 0, 0, 0, 0 });
+}
+
+void PhysicsWorld::setGravity(const b2Vec2& gravity)
+{
+    enqueue({ Command::GRAVITY, 0, 0, gravity.x, gravity.y, 0, 0 });
+}
+
+std::vector<uint8_t> PhysicsWorld::saveState()
+{
+    std::vector<uint8_t> state;
+    runSynchronously({ Command::SAVE, 0, 0, 0, 0, 0, 0, &state });
+    return state;
+}
+
+bool PhysicsWorld::restoreState(const std::vector<uint8_t>& state)
+{
+    // The command only reads the blob, and the caller waits for it
+    auto& in = const_cast<std::vector<uint8_t>&>(state);
+    return runSynchronously({ Command::RESTORE, 0, 0, 0, 0, 0, 0, &in });
+}
+
+bool PhysicsWorld::runSynchronously(Command c)
+{
+    std::promise<bool> done;
+    std::future<bool> result = done.get_future();
+    c.done = &done;
+    const uint64_t seq = enqueue(c);
+    if (c.kind == Command::RESTORE)
+        m_lastRestore = seq;
+
+    // Without a worker the GUI thread is the stepper
+    if (!isThreaded())
+        applyCommands();
+    return result.get();
+}
+
+void PhysicsWorld::stepOnce()
+{
+    applyCommands();
+
+    // Commands have moved bodies already; only the step is interpolated.
+    // Resting bodies keep the transform they came to rest with.
+    for (BodyId id : m_active) {
+        Body& b = m_bodies[id];
+        if (b.body) {
+            b.prevPosition = b.body->GetPosition();
+            b.prevAngle = b.body->GetAngle();
+        }
+    }
+    m_world.Step(kTimeStep, kVelocityIterations, kPositionIterations);
+    updateBodies();
+}
+
+void PhysicsWorld::applyCommands()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_draining.swap(m_commands);
+        m_applied = m_nextCommand - 1;
+    }
+
+    for (const Command& c : m_draining) {
+        if (c.kind == Command::GRAVITY) {
+            m_world.SetGravity(b2Vec2(c.x, c.y));
+            continue;
+        }
+        if (c.kind == Command::GROUND) {
+            b2BodyDef def;
+            def.position.Set(c.x, c.y);
+            b2Body* ground = m_world.CreateBody(&def);
+
+            b2PolygonShape shape;
+            shape.SetAsBox(c.w, c.h);
+
+            b2FixtureDef fixtureDef;
+            fixtureDef.shape = &shape;
+            fixtureDef.friction = 0.8f; // Higher friction to slow down blocks
+            ground->CreateFixture(&fixtureDef);
+            if (!m_ground)
+                m_ground = ground;
+            continue;
+        }
+        if (c.kind == Command::SAVE) {
+            save(*c.state);
+            c.done->set_value(true);
+            continue;
+        }
+        if (c.kind == Command::RESTORE) {
+            c.done->set_value(restore(*c.state));
+            continue;
+        }
+
+        if (c.id >= m_bodies.size()) {
+            m_bodies.resize(c.id + 1);
+            m_marks.resize(c.id + 1);
+        }
+        Body& b = m_bodies[c.id];
+        touch(c.id);
+        switch (c.kind) {
+        case Command::CREATE:
+            if (!m_spareBodies.empty()) {
+                // Moved while inactive, the body only gets its broadphase
+                // proxies back once it is in place
+                b.body = m_spareBodies.back();
+                m_spareBodies.pop_back();
+                b.body->SetTransform(b2Vec2(c.x, c.y), 0.0f);
+                b.body->SetType(b2_dynamicBody);
+                b.body->SetLinearVelocity(b2Vec2_zero);
+                b.body->SetAngularVelocity(0.0f);
+                b.body->SetActive(true);
+                b.body->SetAwake(true);
+            } else {
+                b2BodyDef bodyDef;
+                bodyDef.type = b2_dynamicBody;
+                bodyDef.position.Set(c.x, c.y);
+                b.body = m_world.CreateBody(&bodyDef);
+
+                b.body->SetLinearDamping(0.5f);
+                b.body->SetAngularDamping(0.5f);
+
+                b2PolygonShape shape;
+                shape.SetAsBox(0.5f, 0.5f); // 1m x 1m box
+
+                b2FixtureDef fixtureDef;
+                fixtureDef.shape = &shape;
+                fixtureDef.density = 1.0f;
+                fixtureDef.friction = 0.3f;
+                fixtureDef.restitution = 0.7f; // Less bouncing
+                b.body->CreateFixture(&fixtureDef);
+            }
+            b.body->SetUserData(reinterpret_cast<void*>(uintptr_t(c.id) + 1));
+            b.serial = c.serial;
+            b.moving = false;
+            b.prevPosition = b.body->GetPosition();
+            b.prevAngle = 0.0f;
+            activate(c.id);
+            break;
+
+        case Command::DESTROY: {
+            // A stale entry in m_active is dropped by the next updateBodies()
+            if (b.body) {
+                b.body->SetActive(false);
+                m_spareBodies.push_back(b.body);
+            }
+            const bool listed = b.listed;
+            b = Body();
+            b.listed = listed;
+            break;
+        }
+
+        case Command::MOVE_TO:
+            if (b.body) {
+                const float x = b.body->GetPosition().x;
+                if (b.body->GetType() != b2_staticBody) {
+                    b.body->SetTransform(b.body->GetPosition(), 0.0f);
+                    halt(b.body);
+                }
+                b.slide = Tween(x, c.x, std::abs(c.x - x) / kMoveSpeed);
+                b.moving = true;
+                activate(c.id);
+            }
+            break;
+
+        case Command::PLACE_AT:
+            if (b.body) {
+                b.moving = false;
+                halt(b.body);
+                b.body->SetTransform(b2Vec2(c.x, b.body->GetPosition().y), 0.0f);
+                b.prevPosition = b.body->GetPosition();
+                b.prevAngle = 0.0f;
+            }
+            break;
+
+        case Command::FREEZE:
+            if (b.body) {
+                b.moving = false;
+                b.body->SetTransform(b.body->GetPosition(), 0.0f);
+                halt(b.body);
+                b.prevPosition = b.body->GetPosition();
+                b.prevAngle = 0.0f;
+            }
+            break;
+
+        case Command::GROUND:
+        case Command::GRAVITY:
+        case Command::SAVE:
+        case Command::RESTORE:
+            break;
+        }
+    }
+    m_draining.clear();
+}
+
+void PhysicsWorld::activate(BodyId id)
+{
+    Body& b = m_bodies[id];
+    if (!b.listed) {
+        b.listed = true;
+        m_active.push_back(id);
+    }
+}
+
+void PhysicsWorld::touch(BodyId id)
+{
+    mark(id, kChanged, m_changed);
+}
+
+void PhysicsWorld::mark(BodyId id, uint8_t bit, std::vector<BodyId>& list)
+{
+    if (!(m_marks[id] & bit)) {
+        m_marks[id] |= bit;
+        list.push_back(id);
+    }
+}
+
+void PhysicsWorld::updateBodies()
+{
+    size_t kept = 0;
+    uint32_t moving = 0;
+    for (BodyId id : m_active) {
+        Body& b = m_bodies[id];
+        touch(id);      // Stepped, or come to rest just now
+        if (!b.body) {
+            b.listed = false;
+            continue;
+        }
+        b2Body* body = b.body;
+        b2Vec2 pos = body->GetPosition();
+
+        // 1) Carry a static body along its “moveTo” slide
+        if (b.moving) {
+            body->SetTransform(b2Vec2(b.slide.advance(kTimeStep), pos.y), 0.0f);
+            b.moving = !b.slide.isFinished();
+            pos = body->GetPosition();
+        }
+
+        // 2) Detect landing: nearly still and below threshold
+        if (body->GetType() == b2_dynamicBody &&
+            body->GetLinearVelocity().Length() < 0.01f &&
+            pos.y <= kLandingYThreshold)
+        {
+            // Snap to uniform landing level
+            halt(body);
+            body->SetTransform(b2Vec2(pos.x, kLandingYSnap), 0.0f);
+        }
+
+        // 3) Resting bodies leave the list until a command wakes them, with
+        //    nothing left to blend
+        if (!b.moving && body->GetType() == b2_staticBody) {
+            b.prevPosition = body->GetPosition();
+            b.prevAngle = body->GetAngle();
+            b.listed = false;
+            continue;
+        }
+        moving += b.moving;
+        m_active[kept++] = id;
+    }
+    m_active.resize(kept);
+    m_moving = moving;
+}
+
+void PhysicsWorld::publish()
+{
+    Snapshot& out = m_buffers[m_writeIndex];
+    out.applied = m_applied;
+    out.time = m_simTime;
+    out.unsettled = uint32_t(m_active.size());
+    out.moving = m_moving;
+
+    // What changed since the last publish is out of date in every buffer,
+    // and news to the GUI
+    for (BodyId id : m_changed) {
+        for (unsigned i = 0; i < 3; ++i)
+            mark(id, uint8_t(kStale << i), m_stale[i]);
+        mark(id, kUnseen, m_unseen);
+    }
+    out.changed = m_unseen;
+
+    // Only the bodies this buffer missed are copied
+    std::vector<BodyId>& stale = m_stale[m_writeIndex];
+    out.bodies.resize(m_bodies.size());
+    for (BodyId id : stale) {
+        m_marks[id] &= uint8_t(~(kStale << m_writeIndex));
+        const Body& b = m_bodies[id];
+        Transform& t = out.bodies[id];
+        if (!b.body) {
+            t = Transform();
+            continue;
+        }
+        const b2Vec2& pos = b.body->GetPosition();
+        t.x = pos.x;
+        t.y = pos.y;
+        t.angle = b.body->GetAngle();
+        t.prevX = b.prevPosition.x;
+        t.prevY = b.prevPosition.y;
+        t.prevAngle = b.prevAngle;
+        t.serial = b.serial;
+        t.moving = b.moving;
+        t.resting = b.body->GetType() == b2_staticBody;
+    }
+    stale.clear();
+
+    // Hand the finished array over and take back whichever one was shared
+    const unsigned previous = m_shared.exchange(m_writeIndex | kFresh, std::memory_order_acq_rel);
+    m_writeIndex = previous & ~kFresh;
+
+    // The GUI took the previous snapshot, so only this one's changes are
+    // news to it from the next one on
+    if (!(previous & kFresh)) {
+        for (BodyId id : m_unseen)
+            m_marks[id] &= uint8_t(~kUnseen);
+        m_unseen.clear();
+        for (BodyId id : m_changed)
+            mark(id, kUnseen, m_unseen);
+    }
+    for (BodyId id : m_changed)
+        m_marks[id] &= uint8_t(~kChanged);
+    m_changed.clear();
+}
+
+void PhysicsWorld::save(std::vector<uint8_t>& out) const
+{
+    static_assert(std::is_trivially_copyable_v<Tween>);
+    out.clear();
+    put(out, kStateMagic);
+    put(out, kStateVersion);
+    put(out, m_world.GetGravity());
+
+    uint32_t count = 0;
+    for (const Body& b : m_bodies)
+        count += b.body != nullptr;
+    put(out, count);
+    for (BodyId id = 0; id < m_bodies.size(); ++id) {
+        const Body& b = m_bodies[id];
+        if (!b.body)
+            continue;
+        put(out, id);
+        put(out, b.serial);
+        put(out, uint8_t(b.body->GetType()));
+        put(out, uint8_t(b.body->IsAwake()));
+        put(out, uint8_t(b.moving));
+        put(out, b.body->GetPosition());
+        put(out, b.body->GetAngle());
+        put(out, b.body->GetLinearVelocity());
+        put(out, b.body->GetAngularVelocity());
+        put(out, b.prevPosition);
+        put(out, b.prevAngle);
+        put(out, b.slide);
+    }
+
+    // Contacts are kept by the pair of bodies they join; every block and
+    // the ground have a single fixture each
+    count = 0;
+    const size_t countAt = out.size();
+    put(out, count);
+    for (const b2Contact* c = m_world.GetContactList(); c; c = c->GetNext()) {
+        const b2Manifold* m = c->GetManifold();
+        if (!c->IsTouching() || m->pointCount == 0)
+            continue;
+        put(out, idOf(c->GetFixtureA()->GetBody()));
+        put(out, idOf(c->GetFixtureB()->GetBody()));
+        put(out, uint8_t(m->pointCount));
+        for (int i = 0; i < m->pointCount; ++i)
+            put(out, ContactPoint{ m->points[i].id.key, m->points[i].normalImpulse,
+                                   m->points[i].tangentImpulse });
+        ++count;
+    }
+    std::memcpy(out.data() + countAt, &count, sizeof(count));
+}
+
+bool PhysicsWorld::restore(const std::vector<uint8_t>& in)
+{
+    StateReader r{ in };
+    if (r.get<uint32_t>() != kStateMagic || r.get<uint32_t>() != kStateVersion || !r.ok)
+        return false;
+    m_world.SetGravity(r.get<b2Vec2>());
+
+    bool complete = true;
+    const uint32_t bodies = r.get<uint32_t>();
+    for (uint32_t i = 0; i < bodies && r.ok; ++i) {
+        const BodyId id = r.get<BodyId>();
+        const uint32_t serial = r.get<uint32_t>();
+        const auto type = b2BodyType(r.get<uint8_t>());
+        const bool awake = r.get<uint8_t>();
+        const bool moving = r.get<uint8_t>();
+        const b2Vec2 position = r.get<b2Vec2>();
+        const float angle = r.get<float>();
+        const b2Vec2 velocity = r.get<b2Vec2>();
+        const float angularVelocity = r.get<float>();
+        const b2Vec2 prevPosition = r.get<b2Vec2>();
+        const float prevAngle = r.get<float>();
+        const Tween slide = r.get<Tween>();
+        if (!r.ok)
+            break;
+        if (id >= m_bodies.size() || !m_bodies[id].body || m_bodies[id].serial != serial) {
+            complete = false;
+            continue;
+        }
+
+        Body& b = m_bodies[id];
+        b2Body* body = b.body;
+        body->SetType(type);    // Does nothing if the type is unchanged
+        body->SetTransform(position, angle);
+        body->SetAwake(awake);
+        if (awake) {
+            body->SetLinearVelocity(velocity);
+            body->SetAngularVelocity(angularVelocity);
+        }
+        b.moving = moving;
+        b.slide = slide;
+        b.prevPosition = prevPosition;
+        b.prevAngle = prevAngle;
+        touch(id);
+        if (moving || type != b2_staticBody)
+            activate(id);
+    }
+
+    // Box2D pairs up moved bodies only at the start of a step after a
+    // fixture was added. A throwaway sensor on the ground makes an empty
+    // step create the contacts of the restored layout, whose impulses can
+    // then be put back before the next step warm-starts from them.
+    if (m_ground) {
+        b2CircleShape probe;
+        probe.m_radius = 0.01f;
+        b2FixtureDef probeDef;
+        probeDef.shape = &probe;
+        probeDef.isSensor = true;
+        m_ground->DestroyFixture(m_ground->CreateFixture(&probeDef));
+    }
+    m_world.Step(0.0f, 0, 0);
+
+    const uint32_t contacts = r.get<uint32_t>();
+    std::vector<std::pair<uint64_t, std::vector<ContactPoint>>> saved;
+    saved.reserve(contacts);
+    for (uint32_t i = 0; i < contacts && r.ok; ++i) {
+        const uint64_t a = r.get<uint32_t>();
+        const uint64_t b = r.get<uint32_t>();
+        std::vector<ContactPoint> points(std::min<uint8_t>(r.get<uint8_t>(), b2_maxManifoldPoints));
+        for (ContactPoint& p : points)
+            p = r.get<ContactPoint>();
+        saved.emplace_back(a << 32 | b, std::move(points));
+    }
+    if (!r.ok)
+        return false;
+    std::sort(saved.begin(), saved.end(),
+              [](const auto& x, const auto& y) { return x.first < y.first; });
+
+    for (b2Contact* c = m_world.GetContactList(); c; c = c->GetNext()) {
+        const uint64_t key = uint64_t(idOf(c->GetFixtureA()->GetBody())) << 32
+                             | idOf(c->GetFixtureB()->GetBody());
+        auto it = std::lower_bound(saved.begin(), saved.end(), key,
+                                   [](const auto& x, uint64_t k) { return x.first < k; });
+        if (it == saved.end() || it->first != key)
+            continue;
+        b2Manifold* m = c->GetManifold();
+        for (int i = 0; i < m->pointCount; ++i) {
+            for (const ContactPoint& p : it->second) {
+                if (p.key == m->points[i].id.key) {
+                    m->points[i].normalImpulse = p.normalImpulse;
+                    m->points[i].tangentImpulse = p.tangentImpulse;
+                }
+            }
+        }
+    }
+    return complete;
+}
@@ -0,0 +1,364 @@
+/**
+ * replayfile.cpp
+ *
+ * This file implements the ReplayWriter and ReplayReader classes: the
+ * quantization and delta encoding of frames and the chunk index.
+ */
+#include "replayfile.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    constexpr uint32_t kFileMagic = 0x50524341;     // "ACRP"
+    constexpr uint32_t kIndexMagic = 0x49524341;    // "ACRI"
+    constexpr uint32_t kVersion = 1;
+    constexpr float kPositionScale = 8.0f;          // Steps per pixel
+    constexpr float kAngleScale = 16.0f;            // Steps per degree
+
+    constexpr size_t kHeaderBytes = 3 * sizeof(uint32_t);
+    constexpr size_t kChunkHeaderBytes = 3 * sizeof(uint32_t);
+    constexpr size_t kIndexEntryBytes = sizeof(uint64_t) + sizeof(uint32_t);
+    constexpr size_t kFooterBytes = sizeof(uint64_t) + sizeof(uint32_t);
+
+    // Which fields of a block a delta frame carries
+    constexpr uint8_t kHasX = 1;
+    constexpr uint8_t kHasY = 2;
+    constexpr uint8_t kHasAngle = 4;
+    constexpr uint8_t kHasRgb = 8;
+
+    uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+    int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+    void putVarint(std::vector<uint8_t>& out, uint64_t v)
+    {
+        while (v >= 0x80) {
+            out.push_back(uint8_t(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(uint8_t(v));
+    }
+
+    /* Reads a varint at @p pos, failing instead of reading past @p end */
+    bool getVarint(const uint8_t* data, size_t& pos, size_t end, uint64_t& v)
+    {
+        v = 0;
+        for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+            const uint8_t byte = data[pos++];
+            v |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    template <typename T>
+    T load(const char* p)
+    {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    int32_t quantize(float v, float scale)
+    {
+        return int32_t(std::lround(v * scale));
+    }
+}
+
+ReplayWriter::ReplayWriter(const std::string& path, uint32_t periodMs)
+    : m_path(path)
+{
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        m_error = "cannot write " + path;
+        return;
+    }
+    const uint32_t header[] = { kFileMagic, kVersion, periodMs };
+    write(header, sizeof(header));
+}
+
+ReplayWriter::~ReplayWriter()
+{
+    finish();
+}
+
+void ReplayWriter::addFrame(const std::vector<ReplayBlock>& blocks)
+{
+    if (!m_file)
+        return;
+
+    m_current.resize(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const ReplayBlock& b = blocks[i];
+        m_current[i] = { quantize(b.x, kPositionScale), quantize(b.y, kPositionScale),
+                         quantize(b.rotation, kAngleScale), b.rgb };
+    }
+
+    // Other blocks, or a full chunk, start a chunk with a key frame
+    bool sameBlocks = m_chunkFrames > 0 && m_chunkFrames < kFramesPerChunk
+                      && blocks.size() == m_values.size();
+    for (size_t i = 0; sameBlocks && i < blocks.size(); ++i)
+        sameBlocks = blocks[i].value == m_values[i];
+
+    if (!sameBlocks) {
+        flushChunk();
+        m_values.resize(blocks.size());
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            m_values[i] = blocks[i].value;
+            putVarint(m_payload, zigzag(m_values[i]));
+        }
+        for (const Quantized& q : m_current) {
+            putVarint(m_payload, zigzag(q.x));
+            putVarint(m_payload, zigzag(q.y));
+            putVarint(m_payload, zigzag(q.angle));
+            putVarint(m_payload, q.rgb);
+        }
+    } else {
+        // Delta frame: the changed blocks only
+        size_t changed = 0;
+        for (size_t i = 0; i < m_current.size(); ++i) {
+            const Quantized& a = m_previous[i];
+            const Quantized& b = m_current[i];
+            changed += a.x != b.x || a.y != b.y || a.angle != b.angle || a.rgb != b.rgb;
+        }
+        putVarint(m_payload, changed);
+
+        size_t last = 0;
+        for (size_t i = 0; i < m_current.size() && changed > 0; ++i) {
+            const Quantized& a = m_previous[i];
+            const Quantized& b = m_current[i];
+            const uint8_t mask = (a.x != b.x ? kHasX : 0) | (a.y != b.y ? kHasY : 0)
+                                 | (a.angle != b.angle ? kHasAngle : 0)
+                                 | (a.rgb != b.rgb ? kHasRgb : 0);
+            if (!mask)
+                continue;
+            putVarint(m_payload, i - last);
+            last = i;
+            m_payload.push_back(mask);
+            if (mask & kHasX)
+                putVarint(m_payload, zigzag(int64_t(b.x) - a.x));
+            if (mask & kHasY)
+                putVarint(m_payload, zigzag(int64_t(b.y) - a.y));
+            if (mask & kHasAngle)
+                putVarint(m_payload, zigzag(int64_t(b.angle) - a.angle));
+            if (mask & kHasRgb)
+                putVarint(m_payload, b.rgb);
+        }
+    }
+    m_previous.swap(m_current);
+    ++m_chunkFrames;
+    ++m_frames;
+}
+
+void ReplayWriter::flushChunk()
+{
+    if (m_chunkFrames == 0)
+        return;
+
+    m_index.emplace_back(0, uint32_t(m_frames - m_chunkFrames));
+    const long offset = std::ftell(m_file);
+    m_index.back().first = offset < 0 ? 0 : uint64_t(offset);
+
+    const uint32_t header[] = { m_chunkFrames, uint32_t(m_values.size()),
+                                uint32_t(m_payload.size()) };
+    write(header, sizeof(header));
+    write(m_payload.data(), m_payload.size());
+    m_payload.clear();
+    m_chunkFrames = 0;
+}
+
+bool ReplayWriter::finish()
+{
+    if (!m_file)
+        return m_error.empty();
+
+    flushChunk();
+    const long indexOffset = std::ftell(m_file);
+    const uint32_t chunks = uint32_t(m_index.size());
+    write(&chunks, sizeof(chunks));
+    for (const auto& [offset, firstFrame] : m_index) {
+        write(&offset, sizeof(offset));
+        write(&firstFrame, sizeof(firstFrame));
+    }
+    const uint64_t footerOffset = indexOffset < 0 ? 0 : uint64_t(indexOffset);
+    write(&footerOffset, sizeof(footerOffset));
+    write(&kIndexMagic, sizeof(kIndexMagic));
+
+    if (std::fclose(m_file) != 0 && m_error.empty())
+        m_error = "cannot write " + m_path;
+    m_file = nullptr;
+    return m_error.empty();
+}
+
+void ReplayWriter::write(const void* data, size_t size)
+{
+    if (!m_error.empty() || size == 0)
+        return;
+    if (std::fwrite(data, 1, size, m_file) != size)
+        m_error = "cannot write " + m_path;
+}
+
+ReplayReader::ReplayReader(const std::string& path)
+    : m_file(std::make_unique<MappedFile>(path))
+{
+    if (!m_file->error().empty()) {
+        m_error = m_file->error();
+        return;
+    }
+    const char* data = m_file->data();
+    const size_t size = m_file->size();
+    if (size < kHeaderBytes + sizeof(uint32_t) + kFooterBytes
+        || load<uint32_t>(data) != kFileMagic
+        || load<uint32_t>(data + size - sizeof(uint32_t)) != kIndexMagic) {
+        m_error = path + " is not a replay";
+        return;
+    }
+    if (load<uint32_t>(data + sizeof(uint32_t)) != kVersion) {
+        m_error = path + " was recorded by another version";
+        return;
+    }
+    m_periodMs = load<uint32_t>(data + 2 * sizeof(uint32_t));
+
+    // The index
+    const uint64_t indexOffset = load<uint64_t>(data + size - kFooterBytes);
+    if (indexOffset > size - kFooterBytes - sizeof(uint32_t)) {
+        m_error = path + " is damaged";
+        return;
+    }
+    const uint32_t chunks = load<uint32_t>(data + indexOffset);
+    if (chunks > (size - kFooterBytes - indexOffset - sizeof(uint32_t)) / kIndexEntryBytes) {
+        m_error = path + " is damaged";
+        return;
+    }
+    // Chunks must cover the frames from 0 on, each following the last
+    m_index.resize(chunks);
+    const char* entry = data + indexOffset + sizeof(uint32_t);
+    uint64_t nextFrame = 0;
+    for (auto& [offset, firstFrame] : m_index) {
+        offset = load<uint64_t>(entry);
+        firstFrame = load<uint32_t>(entry + sizeof(uint64_t));
+        entry += kIndexEntryBytes;
+        if (offset < kHeaderBytes || offset + kChunkHeaderBytes > indexOffset
+            || firstFrame != nextFrame) {
+            m_error = path + " is damaged";
+            m_index.clear();
+            return;
+        }
+        const uint32_t frames = load<uint32_t>(data + offset);
+        if (frames == 0) {
+            m_error = path + " is damaged";
+            m_index.clear();
+            return;
+        }
+        nextFrame = uint64_t(firstFrame) + frames;
+    }
+    m_frameCount = size_t(nextFrame);
+}
+
+ReplayReader::~ReplayReader() = default;
+
+bool ReplayReader::readFrame(size_t frame, std::vector<ReplayBlock>& out)
+{
+    if (frame >= m_frameCount)
+        return false;
+
+    // From the key frame of the chunk unless reading on within it
+    auto it = std::upper_bound(m_index.begin(), m_index.end(), frame,
+                               [](size_t f, const auto& e) { return f < e.second; });
+    if (it == m_index.begin())
+        return false;
+    const size_t chunk = size_t(it - m_index.begin()) - 1;
+    if (chunk != m_chunk || frame < m_frame) {
+        if (!openChunk(chunk)) {
+            m_chunk = SIZE_MAX;
+            return false;
+        }
+    }
+    while (m_frame < frame) {
+        if (!nextFrame()) {
+            m_chunk = SIZE_MAX;
+            return false;
+        }
+    }
+
+    out.resize(m_state.size());
+    for (size_t i = 0; i < m_state.size(); ++i) {
+        const Quantized& q = m_state[i];
+        out[i] = { q.x / kPositionScale, q.y / kPositionScale, q.angle / kAngleScale, q.rgb,
+                   m_values[i] };
+    }
+    return true;
+}
+
+bool ReplayReader::openChunk(size_t chunk)
+{
+    const char* data = m_file->data();
+    const uint64_t offset = m_index[chunk].first;
+    m_chunkFrames = load<uint32_t>(data + offset);
+    const uint32_t blocks = load<uint32_t>(data + offset + sizeof(uint32_t));
+    const uint32_t bytes = load<uint32_t>(data + offset + 2 * sizeof(uint32_t));
+    m_pos = offset + kChunkHeaderBytes;
+    m_end = m_pos + bytes;
+    if (m_end > m_file->size() || blocks > bytes)
+        return false;
+
+    const auto* p = reinterpret_cast<const uint8_t*>(data);
+    uint64_t v = 0;
+    m_values.resize(blocks);
+    for (int32_t& value : m_values) {
+        if (!getVarint(p, m_pos, m_end, v))
+            return false;
+        value = int32_t(unzigzag(v));
+    }
+    m_state.resize(blocks);
+    for (Quantized& q : m_state) {
+        int32_t* fields[] = { &q.x, &q.y, &q.angle };
+        for (int32_t* f : fields) {
+            if (!getVarint(p, m_pos, m_end, v))
+                return false;
+            *f = int32_t(unzigzag(v));
+        }
+        if (!getVarint(p, m_pos, m_end, v))
+            return false;
+        q.rgb = uint32_t(v);
+    }
+    m_chunk = chunk;
+    m_frame = m_index[chunk].second;
+    return true;
+}
+
+bool ReplayReader::nextFrame()
+{
+    if (m_frame + 1 >= m_index[m_chunk].second + size_t(m_chunkFrames))
+        return false;
+
+    const auto* p = reinterpret_cast<const uint8_t*>(m_file->data());
+    uint64_t changed = 0, v = 0;
+    if (!getVarint(p, m_pos, m_end, changed))
+        return false;
+    size_t i = 0;
+    for (uint64_t c = 0; c < changed; ++c) {
+        if (!getVarint(p, m_pos, m_end, v) || (i += v) >= m_state.size() || m_pos >= m_end)
+            return false;
+        Quantized& q = m_state[i];
+        const uint8_t mask = p[m_pos++];
+        int32_t* fields[] = { &q.x, &q.y, &q.angle };
+        const uint8_t bits[] = { kHasX, kHasY, kHasAngle };
+        for (int f = 0; f < 3; ++f) {
+            if (!(mask & bits[f]))
+                continue;
+            if (!getVarint(p, m_pos, m_end, v))
+                return false;
+            *fields[f] = int32_t(*fields[f] + unzigzag(v));
+        }
+        if (mask & kHasRgb) {
+            if (!getVarint(p, m_pos, m_end, v))
+                return false;
+            q.rgb = uint32_t(v);
+        }
+    }
+    ++m_frame;
+    return true;
+}
@@ -0,0 +1,340 @@
+/**
+ * simdsort.cpp
+ *
+ * This file implements the SimdSort class: the per-instruction-set block
+ * sort and merge kernels and the merge passes that drive them.
+ */
+#include "simdsort.h"
+#include <algorithm>
+#include <climits>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMDSORT_X86 1
+#include <immintrin.h>
+#define SIMDSORT_SSE4 __attribute__((target("sse4.1"), always_inline)) inline
+#define SIMDSORT_AVX2 __attribute__((target("avx2"), always_inline)) inline
+#endif
+
+namespace {
+    /**
+     * One instruction set's kernels. sortBlocks() turns every group of
+     * `block` keys into sorted runs of `run` keys; merge() merges two
+     * sorted runs whose lengths are non-zero multiples of `width`.
+     */
+    struct Kernels {
+        size_t width;
+        size_t run;
+        size_t block;
+        void (*sortBlocks)(int* keys, size_t n);
+        void (*merge)(const int* a, size_t na, const int* b, size_t nb, int* out);
+    };
+
+    /* Keys merged within one chunk before the whole-array passes; the
+       chunk and its buffer fit in L2. */
+    constexpr size_t kChunk = 1 << 15;
+
+    namespace scalar {
+        constexpr size_t kRun = 16;
+
+        void sortBlocks(int* keys, size_t n)
+        {
+            for (size_t lo = 0; lo < n; lo += kRun) {
+                int* block = keys + lo;
+                for (size_t i = 1; i < kRun; ++i) {
+                    const int key = block[i];
+                    size_t j = i;
+                    for (; j > 0 && key < block[j - 1]; --j)
+                        block[j] = block[j - 1];
+                    block[j] = key;
+                }
+            }
+        }
+
+        void merge(const int* a, size_t na, const int* b, size_t nb, int* out)
+        {
+            const int* aEnd = a + na;
+            const int* bEnd = b + nb;
+            while (a != aEnd && b != bEnd) {
+                // The comparison result moves both cursors; no branch on the keys
+                const bool takeB = *b < *a;
+                *out++ = takeB ? *b : *a;
+                b += takeB;
+                a += !takeB;
+            }
+            out = std::copy(a, aEnd, out);
+            std::copy(b, bEnd, out);
+        }
+    }
+
+#ifdef SIMDSORT_X86
+    namespace sse4 {
+        SIMDSORT_SSE4 void exchange(__m128i& a, __m128i& b)
+        {
+            const __m128i lo = _mm_min_epi32(a, b);
+            b = _mm_max_epi32(a, b);
+            a = lo;
+        }
+
+        /* Sorts a bitonic vector */
+        SIMDSORT_SSE4 __m128i clean(__m128i v)
+        {
+            __m128i t = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+            v = _mm_blend_epi16(_mm_min_epi32(v, t), _mm_max_epi32(v, t), 0xF0);
+            t = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+            return _mm_blend_epi16(_mm_min_epi32(v, t), _mm_max_epi32(v, t), 0xCC);
+        }
+
+        /* Merges two sorted vectors: a gets the lower, b the upper half */
+        SIMDSORT_SSE4 void merge2(__m128i& a, __m128i& b)
+        {
+            b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 1, 2, 3));
+            exchange(a, b);
+            a = clean(a);
+            b = clean(b);
+        }
+
+        __attribute__((target("sse4.1")))
+        void sortBlocks(int* keys, size_t n)
+        {
+            for (size_t lo = 0; lo < n; lo += 16) {
+                __m128i* p = reinterpret_cast<__m128i*>(keys + lo);
+                __m128i r0 = _mm_loadu_si128(p), r1 = _mm_loadu_si128(p + 1);
+                __m128i r2 = _mm_loadu_si128(p + 2), r3 = _mm_loadu_si128(p + 3);
+
+                // 4-key network down the columns
+                exchange(r0, r1); exchange(r2, r3);
+                exchange(r0, r2); exchange(r1, r3);
+                exchange(r1, r2);
+
+                // Transpose so every register holds one sorted column
+                __m128 f0 = _mm_castsi128_ps(r0), f1 = _mm_castsi128_ps(r1);
+                __m128 f2 = _mm_castsi128_ps(r2), f3 = _mm_castsi128_ps(r3);
+                _MM_TRANSPOSE4_PS(f0, f1, f2, f3);
+                r0 = _mm_castps_si128(f0); r1 = _mm_castps_si128(f1);
+                r2 = _mm_castps_si128(f2); r3 = _mm_castps_si128(f3);
+
+                merge2(r0, r1);
+                merge2(r2, r3);
+
+                _mm_storeu_si128(p, r0); _mm_storeu_si128(p + 1, r1);
+                _mm_storeu_si128(p + 2, r2); _mm_storeu_si128(p + 3, r3);
+            }
+        }
+
+        __attribute__((target("sse4.1")))
+        void merge(const int* a, size_t na, const int* b, size_t nb, int* out)
+        {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+            size_t ia = 4, ib = 4;
+            for (;;) {
+                merge2(lo, hi);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+                out += 4;
+                if (ia == na && ib == nb)
+                    break;
+                // Continue with the run whose next key is smaller
+                const bool takeA = ib == nb || (ia != na && a[ia] <= b[ib]);
+                const int* next = takeA ? a + ia : b + ib;
+                ia += takeA ? 4 : 0;
+                ib += takeA ? 0 : 4;
+                lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(next));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), hi);
+        }
+    }
+
+    namespace avx2 {
+        SIMDSORT_AVX2 void exchange(__m256i& a, __m256i& b)
+        {
+            const __m256i lo = _mm256_min_epi32(a, b);
+            b = _mm256_max_epi32(a, b);
+            a = lo;
+        }
+
+        /* Sorts a bitonic vector: half-distance 4, 2, then 1 */
+        SIMDSORT_AVX2 __m256i clean(__m256i v)
+        {
+            __m256i t = _mm256_permute2x128_si256(v, v, 1);
+            v = _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xF0);
+            t = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+            v = _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xCC);
+            t = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+            return _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xAA);
+        }
+
+        /* Merges two sorted vectors: a gets the lower, b the upper half */
+        SIMDSORT_AVX2 void merge2(__m256i& a, __m256i& b)
+        {
+            b = _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+            exchange(a, b);
+            a = clean(a);
+            b = clean(b);
+        }
+
+        SIMDSORT_AVX2 void transpose(__m256i r[8])
+        {
+            __m256 t[8], u[8];
+            for (int i = 0; i < 8; i += 2) {
+                t[i]     = _mm256_unpacklo_ps(_mm256_castsi256_ps(r[i]), _mm256_castsi256_ps(r[i + 1]));
+                t[i + 1] = _mm256_unpackhi_ps(_mm256_castsi256_ps(r[i]), _mm256_castsi256_ps(r[i + 1]));
+            }
+            for (int i = 0; i < 8; i += 4) {
+                u[i]     = _mm256_shuffle_ps(t[i],     t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+                u[i + 1] = _mm256_shuffle_ps(t[i],     t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+                u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+                u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+            }
+            for (int i = 0; i < 4; ++i) {
+                r[i]     = _mm256_castps_si256(_mm256_permute2f128_ps(u[i], u[i + 4], 0x20));
+                r[i + 4] = _mm256_castps_si256(_mm256_permute2f128_ps(u[i], u[i + 4], 0x31));
+            }
+        }
+
+        __attribute__((target("avx2")))
+        void sortBlocks(int* keys, size_t n)
+        {
+            for (size_t lo = 0; lo < n; lo += 64) {
+                __m256i* p = reinterpret_cast<__m256i*>(keys + lo);
+                __m256i r[8];
+                for (int i = 0; i < 8; ++i)
+                    r[i] = _mm256_loadu_si256(p + i);
+
+                // 19-comparator 8-key network down the columns
+                exchange(r[0], r[2]); exchange(r[1], r[3]); exchange(r[4], r[6]); exchange(r[5], r[7]);
+                exchange(r[0], r[4]); exchange(r[1], r[5]); exchange(r[2], r[6]); exchange(r[3], r[7]);
+                exchange(r[0], r[1]); exchange(r[2], r[3]); exchange(r[4], r[5]); exchange(r[6], r[7]);
+                exchange(r[2], r[4]); exchange(r[3], r[5]);
+                exchange(r[1], r[4]); exchange(r[3], r[6]);
+                exchange(r[1], r[2]); exchange(r[3], r[4]); exchange(r[5], r[6]);
+
+                // Transpose so every register holds one sorted column
+                transpose(r);
+
+                for (int i = 0; i < 8; i += 2)
+                    merge2(r[i], r[i + 1]);
+
+                for (int i = 0; i < 8; ++i)
+                    _mm256_storeu_si256(p + i, r[i]);
+            }
+        }
+
+        __attribute__((target("avx2")))
+        void merge(const int* a, size_t na, const int* b, size_t nb, int* out)
+        {
+            __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+            __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+            size_t ia = 8, ib = 8;
+            for (;;) {
+                merge2(lo, hi);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), lo);
+                out += 8;
+                if (ia == na && ib == nb)
+                    break;
+                // Continue with the run whose next key is smaller
+                const bool takeA = ib == nb || (ia != na && a[ia] <= b[ib]);
+                const int* next = takeA ? a + ia : b + ib;
+                ia += takeA ? 8 : 0;
+                ib += takeA ? 0 : 8;
+                lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(next));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), hi);
+        }
+    }
+#endif
+
+    const Kernels& kernels(SimdSort::Isa isa)
+    {
+        static const Kernels kScalar = { 1, scalar::kRun, scalar::kRun, scalar::sortBlocks, scalar::merge };
+#ifdef SIMDSORT_X86
+        static const Kernels kSse4 = { 4, 8, 16, sse4::sortBlocks, sse4::merge };
+        static const Kernels kAvx2 = { 8, 16, 64, avx2::sortBlocks, avx2::merge };
+        switch (isa) {
+        case SimdSort::AVX2: return kAvx2;
+        case SimdSort::SSE4: return kSse4;
+        case SimdSort::SCALAR: break;
+        }
+#else
+        (void)isa;
+#endif
+        return kScalar;
+    }
+
+    /* Merges neighbouring runs of length run from src into dst */
+    void mergePass(const Kernels& k, const int* src, int* dst, size_t n, size_t run)
+    {
+        for (size_t lo = 0; lo < n; lo += 2 * run) {
+            const size_t mid = std::min(lo + run, n);
+            const size_t hi = std::min(lo + 2 * run, n);
+            if (mid == hi)
+                std::copy(src + lo, src + hi, dst + lo);
+            else
+                k.merge(src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+        }
+    }
+
+    /* Merges runs of run keys until a single run is left; returns the
+       buffer that holds the result */
+    int* mergeAll(const Kernels& k, int* keys, int* buffer, size_t n, size_t run)
+    {
+        for (; run < n; run *= 2) {
+            mergePass(k, keys, buffer, n, run);
+            std::swap(keys, buffer);
+        }
+        return keys;
+    }
+}
+
+SimdSort::Isa SimdSort::bestIsa()
+{
+#ifdef SIMDSORT_X86
+    static const Isa best = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return SSE4;
+        return SCALAR;
+    }();
+    return best;
+#else
+    return SCALAR;
+#endif
+}
+
+const char* SimdSort::name(Isa isa)
+{
+    switch (isa) {
+    case SCALAR: return "scalar";
+    case SSE4:   return "SSE4.1";
+    case AVX2:   return "AVX2";
+    }
+    return "unknown";
+}
+
+void SimdSort::sort(int* keys, size_t n, Isa isa)
+{
+    if (n < 2)
+        return;
+
+    const Kernels& k = kernels(std::min(isa, bestIsa()));
+
+    // Pad to whole register blocks with keys that sort to the end
+    const size_t padded = (n + k.block - 1) / k.block * k.block;
+    std::vector<int> data(padded, INT_MAX);
+    std::vector<int> buffer(padded);
+    std::copy(keys, keys + n, data.begin());
+
+    k.sortBlocks(data.data(), padded);
+
+    for (size_t lo = 0; lo < padded; lo += kChunk) {
+        const size_t length = std::min(kChunk, padded - lo);
+        const int* sorted = mergeAll(k, data.data() + lo, buffer.data() + lo, length, k.run);
+        if (sorted != data.data() + lo)
+            std::copy(sorted, sorted + length, data.data() + lo);
+    }
+
+    const int* sorted = mergeAll(k, data.data(), buffer.data(), padded, kChunk);
+    std::copy(sorted, sorted + n, keys);
+}
@@ -0,0 +1,528 @@
+/**
+ * sortengine.cpp
+ *
+ * This file implements the SortEngine class. Every algorithm is a coroutine
+ * written as a plain loop over the key array that co_yields a TraceEvent
+ * after each compare, swap or move it performs. Sorting networks can also
+ * be run headless with each layer spread over all cores.
+ */
+#include "sortengine.h"
+#include "parallelsort.h"
+#include <algorithm>
+#include <cassert>
+#include <barrier>
+#include <random>
+#include <thread>
+#include <utility>
+
+namespace {
+    using Op = TraceEvent::Op;
+
+    TraceEvent event(Op op, size_t a, size_t b = 0)
+    {
+        return { op, static_cast<uint32_t>(a), static_cast<uint32_t>(b) };
+    }
+
+    SortStepper bubbleSort(std::vector<int>& k)
+    {
+        const size_t n = k.size();
+        for (size_t last = n; last > 1; --last) {
+            for (size_t i = 0; i + 1 < last; ++i) {
+                co_yield event(Op::COMPARE, i, i + 1);
+                if (k[i + 1] < k[i]) {
+                    std::swap(k[i], k[i + 1]);
+                    co_yield event(Op::SWAP, i, i + 1);
+                }
+            }
+        }
+    }
+
+    SortStepper insertionSort(std::vector<int>& k)
+    {
+        const size_t n = k.size();
+        for (size_t i = 1; i < n; ++i) {
+            for (size_t j = i; j > 0; --j) {
+                co_yield event(Op::COMPARE, j, j - 1);
+                if (!(k[j] < k[j - 1]))
+                    break;
+                std::swap(k[j - 1], k[j]);
+                co_yield event(Op::SWAP, j - 1, j);
+            }
+        }
+    }
+
+    SortStepper selectionSort(std::vector<int>& k)
+    {
+        const size_t n = k.size();
+        for (size_t i = 0; i + 1 < n; ++i) {
+            size_t minIdx = i;
+            for (size_t j = i + 1; j < n; ++j) {
+                co_yield event(Op::COMPARE, j, minIdx);
+                if (k[j] < k[minIdx]) {
+                    minIdx = j;
+                    co_yield event(Op::FOCUS, minIdx);
+                }
+            }
+            if (minIdx != i) {
+                std::swap(k[minIdx], k[i]);
+                co_yield event(Op::SWAP, minIdx, i);
+            }
+        }
+    }
+
+    /* Hoare partitioning around a pseudo-random key, with an explicit stack
+       of half-open ranges; the smaller side is handled first so the stack
+       stays O(log n) deep. The pivot generator has a fixed seed so a run is
+       reproducible event for event, yet sorted or organ-pipe inputs do not
+       degrade to O(n²). Both scans stop on keys equal to the pivot, which
+       keeps inputs with many duplicates at O(n log n) too. The pivot's
+       index is tracked through swaps so comparisons can name it. */
+    SortStepper quickSort(std::vector<int>& k)
+    {
+        std::minstd_rand pivotRng(static_cast<uint32_t>(k.size()) + 1);
+        std::vector<std::pair<size_t, size_t>> ranges;
+        ranges.emplace_back(0, k.size());
+
+        while (!ranges.empty()) {
+            auto [lo, hi] = ranges.back();
+            ranges.pop_back();
+            if (hi - lo < 2)
+                continue;
+
+            // Any key but the last: Hoare partitioning needs j < hi - 1 to make progress
+            size_t pivot = lo + pivotRng() % (hi - lo - 1);
+            co_yield event(Op::FOCUS, pivot);
+
+            size_t i = lo, j = hi - 1;
+            for (;;) {
+                for (;; ++i) {
+                    co_yield event(Op::COMPARE, i, pivot);
+                    if (!(k[i] < k[pivot]))
+                        break;
+                }
+                for (;; --j) {
+                    co_yield event(Op::COMPARE, j, pivot);
+                    if (!(k[pivot] < k[j]))
+                        break;
+                }
+                if (i >= j)
+                    break;
+
+                std::swap(k[i], k[j]);
+                co_yield event(Op::SWAP, i, j);
+                if (pivot == i)
+                    pivot = j;
+                else if (pivot == j)
+                    pivot = i;
+                ++i;
+                --j;
+            }
+
+            // [lo, j] and [j + 1, hi) are partitioned
+            const size_t split = j + 1;
+            if (split - lo < hi - split) {
+                ranges.emplace_back(split, hi);
+                ranges.emplace_back(lo, split);
+            } else {
+                ranges.emplace_back(lo, split);
+                ranges.emplace_back(split, hi);
+            }
+        }
+    }
+
+    /* Bottom-up merge sort. The keys are merged through a buffer holding the
+       left run, but events describe the equivalent in-place merge: taking
+       the right head moves it in front of the remaining left run. */
+    SortStepper mergeSort(std::vector<int>& k)
+    {
+        const size_t n = k.size();
+        std::vector<int> buf;
+        buf.reserve(n / 2 + 1);
+
+        for (size_t width = 1; width < n; width *= 2) {
+            for (size_t lo = 0; lo + width < n; lo += 2 * width) {
+                const size_t mid = lo + width;
+                const size_t hi = std::min(lo + 2 * width, n);
+
+                buf.assign(k.begin() + lo, k.begin() + mid);
+                size_t out = lo, li = 0, j = mid;
+                while (li < buf.size() && j < hi) {
+                    co_yield event(Op::COMPARE, j, out);
+                    if (k[j] < buf[li]) {
+                        k[out] = k[j];
+                        co_yield event(Op::MOVE, j, out);
+                        ++j;
+                    } else {
+                        k[out] = buf[li++];
+                    }
+                    ++out;
+                }
+                while (li < buf.size())
+                    k[out++] = buf[li++];
+            }
+        }
+    }
+
+    /* Classic in-place heapsort: the heapify and extraction phases share
+       one sift-down loop. */
+    SortStepper heapSort(std::vector<int>& k)
+    {
+        size_t start = k.size() / 2;
+        size_t end = k.size();
+
+        while (end > 1) {
+            if (start > 0) {
+                --start;
+            } else {
+                --end;
+                std::swap(k[0], k[end]);
+                co_yield event(Op::SWAP, 0, end);
+            }
+
+            size_t root = start;
+            for (size_t child = 2 * root + 1; child < end; child = 2 * root + 1) {
+                if (child + 1 < end) {
+                    co_yield event(Op::COMPARE, child, child + 1);
+                    if (k[child] < k[child + 1])
+                        ++child;
+                }
+                co_yield event(Op::COMPARE, root, child);
+                if (!(k[root] < k[child]))
+                    break;
+                std::swap(k[root], k[child]);
+                co_yield event(Op::SWAP, root, child);
+                root = child;
+            }
+        }
+    }
+
+    /* Shell sort with Knuth's 3h+1 gap sequence. */
+    SortStepper shellSort(std::vector<int>& k)
+    {
+        const size_t n = k.size();
+        size_t gap = 1;
+        while (gap < n / 3)
+            gap = 3 * gap + 1;
+
+        for (; gap > 0; gap /= 3) {
+            for (size_t i = gap; i < n; ++i) {
+                for (size_t j = i; j >= gap; j -= gap) {
+                    co_yield event(Op::COMPARE, j, j - gap);
+                    if (!(k[j] < k[j - gap]))
+                        break;
+                    std::swap(k[j - gap], k[j]);
+                    co_yield event(Op::SWAP, j - gap, j);
+                }
+            }
+        }
+    }
+}
+
+namespace {
+    /* Sorting networks. A network is a fixed sequence of layers; within a
+       layer every element x has at most one partner l > x, so the layer's
+       compare-exchanges are disjoint and may run in any order or in
+       parallel. Every comparator puts the smaller key at the lower index.
+       Sizes that are not a power of two behave as if padded with +infinity
+       at the end, so comparators reaching past n are simply dropped. */
+    constexpr size_t kNoPartner = static_cast<size_t>(-1);
+
+    /* Below this size a parallel network run costs more than it saves. */
+    constexpr size_t kParallelThreshold = 1 << 16;
+
+    struct NetworkLayer {
+        SortEngine::Algorithm algorithm;
+        size_t p;   // Bitonic: merge size; odd-even merge: p; transposition: round
+        size_t k;   // Bitonic: comparator distance; odd-even merge: k
+
+        size_t partner(size_t x, size_t n) const
+        {
+            size_t l = kNoPartner;
+            switch (algorithm) {
+            case SortEngine::BITONIC:
+                // The first layer of every merge compares mirrored positions
+                l = k == p / 2 ? x ^ (p - 1) : x ^ k;
+                break;
+            case SortEngine::ODD_EVEN:
+                if ((x & 1) == (p & 1))
+                    l = x + 1;
+                break;
+            case SortEngine::ODD_EVEN_MERGE: {
+                const size_t offset = k % p;
+                if (x >= offset && (x - offset) % (2 * k) < k
+                    && x / (2 * p) == (x + k) / (2 * p))
+                    l = x + k;
+                break;
+            }
+            default:
+                break;
+            }
+            return l > x && l < n ? l : kNoPartner;
+        }
+
+        bool empty(size_t n) const
+        {
+            for (size_t x = 0; x < n; ++x)
+                if (partner(x, n) != kNoPartner)
+                    return false;
+            return true;
+        }
+    };
+
+    std::vector<NetworkLayer> networkLayers(SortEngine::Algorithm a, size_t n)
+    {
+        std::vector<NetworkLayer> layers;
+        if (n < 2)
+            return layers;
+
+        size_t padded = 1;
+        while (padded < n)
+            padded *= 2;
+
+        switch (a) {
+        case SortEngine::BITONIC:
+            for (size_t p = 2; p <= padded; p *= 2)
+                for (size_t k = p / 2; k > 0; k /= 2)
+                    layers.push_back({ a, p, k });
+            break;
+        case SortEngine::ODD_EVEN:
+            for (size_t round = 0; round < n; ++round)
+                layers.push_back({ a, round, 0 });
+            break;
+        case SortEngine::ODD_EVEN_MERGE:
+            for (size_t p = 1; p < padded; p *= 2)
+                for (size_t k = p; k > 0; k /= 2)
+                    layers.push_back({ a, p, k });
+            break;
+        default:
+            break;
+        }
+
+        // Padding can leave layers whose comparators all fall past n
+        layers.erase(std::remove_if(layers.begin(), layers.end(),
+                                    [n](const NetworkLayer& l) { return l.empty(n); }),
+                     layers.end());
+        return layers;
+    }
+
+    /* Emits each comparator of a layer as COMPARE (+ SWAP), then a LAYER
+       event closing the layer. */
+    SortStepper networkSort(std::vector<int>& k, SortEngine::Algorithm a)
+    {
+        const size_t n = k.size();
+        const std::vector<NetworkLayer> layers = networkLayers(a, n);
+
+        for (size_t layer = 0; layer < layers.size(); ++layer) {
+            for (size_t x = 0; x < n; ++x) {
+                const size_t l = layers[layer].partner(x, n);
+                if (l == kNoPartner)
+                    continue;
+                co_yield event(Op::COMPARE, x, l);
+                if (k[l] < k[x]) {
+                    std::swap(k[x], k[l]);
+                    co_yield event(Op::SWAP, x, l);
+                }
+            }
+            co_yield event(Op::LAYER, layer);
+        }
+    }
+
+    /* Applies a network with one thread per core. Each thread owns a fixed
+       slice of lower indices x; the comparators of one layer are disjoint,
+       so the only synchronisation needed is a barrier between layers. */
+    SortEngine::Stats runNetworkParallel(SortEngine::Algorithm a, std::vector<int>& k,
+                                         unsigned threads, bool modelCache)
+    {
+        const size_t n = k.size();
+        const std::vector<NetworkLayer> layers = networkLayers(a, n);
+        std::vector<SortEngine::Stats> local(threads);
+        std::barrier sync(threads);
+
+        auto worker = [&](unsigned t) {
+            const size_t begin = n * t / threads;
+            const size_t end = n * (t + 1) / threads;
+            SortEngine::Stats& stats = local[t];
+            CacheModel cache;
+            CacheModel* model = modelCache ? &cache : nullptr;
+            for (const NetworkLayer& layer : layers) {
+                for (size_t x = begin; x < end; ++x) {
+                    const size_t l = layer.partner(x, n);
+                    if (l == kNoPartner)
+                        continue;
+                    SortEngine::count(stats, { Op::COMPARE, uint32_t(x), uint32_t(l) }, model);
+                    if (k[l] < k[x]) {
+                        std::swap(k[x], k[l]);
+                        SortEngine::count(stats, { Op::SWAP, uint32_t(x), uint32_t(l) }, model);
+                    }
+                }
+                sync.arrive_and_wait();
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t)
+            pool.emplace_back(worker, t);
+        worker(0);
+        for (std::thread& th : pool)
+            th.join();
+
+        SortEngine::Stats total;
+        for (const SortEngine::Stats& s : local)
+            total += s;
+        total.events += layers.size();
+        return total;
+    }
+}
+
+namespace {
+    /* Runs a parallel algorithm with tracing, then replays its tasks in
+       the order they started. Tasks that may run concurrently work on
+       disjoint ranges and a task only starts after those it depends on
+       have finished, so the replay ends in the parallel run's result. */
+    SortStepper parallelSort(std::vector<int>& k, SortEngine::Algorithm a)
+    {
+        std::vector<int> copy = k;
+        const ParallelSort::Result result =
+            ParallelSort::run(a, copy, WorkStealingPool::shared(), true);
+
+        for (const ParallelSort::Task& task : result.tasks) {
+            co_yield event(Op::TASK, task.worker, task.lo);
+            for (size_t i = 0; i < task.trace.size(); ++i) {
+                const TraceEvent e = task.trace.at(i);
+                if (e.op == Op::SWAP) {
+                    std::swap(k[e.a], k[e.b]);
+                } else if (e.op == Op::MOVE && e.a > e.b) {
+                    std::rotate(k.begin() + e.b, k.begin() + e.a, k.begin() + e.a + 1);
+                } else if (e.op == Op::MOVE) {
+                    std::rotate(k.begin() + e.a, k.begin() + e.a + 1, k.begin() + e.b + 1);
+                }
+                co_yield e;
+            }
+        }
+    }
+}
+
+const char* SortEngine::name(Algorithm a)
+{
+    switch (a) {
+    case BUBBLE:    return "Bubble Sort";
+    case INSERTION: return "Insertion Sort";
+    case SELECTION: return "Selection Sort";
+    case QUICK:     return "Quick Sort";
+    case MERGE:     return "Merge Sort";
+    case HEAP:      return "Heap Sort";
+    case SHELL:     return "Shell Sort";
+    case BITONIC:   return "Bitonic Sort";
+    case ODD_EVEN:  return "Odd-Even Transposition Sort";
+    case ODD_EVEN_MERGE: return "Odd-Even Merge Sort";
+    case PARALLEL_MERGE: return "Parallel Merge Sort";
+    case PARALLEL_QUICK: return "Parallel Quick Sort";
+    }
+    return "Unknown";
+}
+
+bool SortEngine::isNetwork(Algorithm a)
+{
+    return a == BITONIC || a == ODD_EVEN || a == ODD_EVEN_MERGE;
+}
+
+bool SortEngine::isParallel(Algorithm a)
+{
+    return a == PARALLEL_MERGE || a == PARALLEL_QUICK;
+}
+
+bool SortEngine::isQuadratic(Algorithm a)
+{
+    return a == BUBBLE || a == SELECTION || a == INSERTION || a == ODD_EVEN
+           || a == MERGE || a == PARALLEL_MERGE;
+}
+
+SortStepper SortEngine::steps(Algorithm a, std::vector<int>& keys)
+{
+    switch (a) {
+    case BUBBLE:    return bubbleSort(keys);
+    case INSERTION: return insertionSort(keys);
+    case SELECTION: return selectionSort(keys);
+    case QUICK:     return quickSort(keys);
+    case MERGE:     return mergeSort(keys);
+    case HEAP:      return heapSort(keys);
+    case SHELL:     return shellSort(keys);
+    case BITONIC:
+    case ODD_EVEN:
+    case ODD_EVEN_MERGE:
+        return networkSort(keys, a);
+    case PARALLEL_MERGE:
+    case PARALLEL_QUICK:
+        return parallelSort(keys, a);
+    }
+    return SortStepper();
+}
+
+namespace {
+    /* Adds unit times the event's counters; unit is 1 or, to subtract,
+       uint64_t(-1), which is exact in unsigned arithmetic. */
+    void tally(SortEngine::Stats& stats, const TraceEvent& e, uint64_t unit)
+    {
+        stats.events += unit;
+        switch (e.op) {
+        case TraceEvent::COMPARE:
+            stats.comparisons += unit;
+            stats.reads += 2 * unit;
+            break;
+        case TraceEvent::SWAP:
+            stats.swaps += unit;
+            stats.moves += 3 * unit;
+            stats.reads += 2 * unit;
+            stats.writes += 2 * unit;
+            break;
+        case TraceEvent::MOVE:
+            stats.moves += unit;
+            stats.reads += unit;
+            stats.writes += unit;
+            break;
+        case TraceEvent::FOCUS:
+        case TraceEvent::LAYER:
+        case TraceEvent::TASK:
+            break;
+        }
+    }
+}
+
+void SortEngine::count(Stats& stats, const TraceEvent& e, CacheModel* cache)
+{
+    tally(stats, e, 1);
+    if (cache && (e.op == TraceEvent::COMPARE || e.op == TraceEvent::SWAP
+                  || e.op == TraceEvent::MOVE)) {
+        stats.cacheMisses += cache->access(e.a);
+        stats.cacheMisses += cache->access(e.b);
+    }
+}
+
+void SortEngine::uncount(Stats& stats, const TraceEvent& e)
+{
+    tally(stats, e, uint64_t(-1));
+}
+
+SortEngine::Stats SortEngine::run(Algorithm a, std::vector<int>& keys, SortTrace* trace,
+                                  CacheModel* cache)
+{
+    assert(!trace || keys.size() <= size_t(SortTrace::kMaxIndex) + 1);
+
+    if (!trace && isNetwork(a) && keys.size() >= kParallelThreshold) {
+        const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        if (threads > 1)
+            return runNetworkParallel(a, keys, threads, cache != nullptr);
+    }
+    if (!trace && isParallel(a))
+        return ParallelSort::run(a, keys, WorkStealingPool::shared(), false, cache != nullptr).stats;
+
+    Stats stats;
+    SortStepper stepper = steps(a, keys);
+    TraceEvent e;
+    while (stepper.next(e)) {
+        count(stats, e, cache);
+        if (trace)
+            trace->append(e.op, e.a, e.b);
+    }
+    return stats;
+}
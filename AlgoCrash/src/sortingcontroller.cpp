@@ -1,288 +1,544 @@
 /**
  * sortingcontroller.cpp
  *
- * This file implements the SortingController class which manages the execution
- * of sorting algorithms (bubble sort, insertion sort, selection sort) and
- * tracks performance statistics.
+ * This file implements the SortingController class which steps a headless
+ * SortEngine algorithm (bubble, insertion, selection, quick, merge, heap and
+ * shell sort, the bitonic and odd-even sorting networks and the parallel
+ * merge sort and quicksort), applies its events to PhysicsBlocks, or to a
+ * bare key array in headless mode, and tracks performance statistics.
  *
  * Checked by: [Devin Gupta]
  */
 
 #include "sortingcontroller.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    /* Lifts the element at from out and reinserts it at to. */
+    template <typename It>
+    void rotateOne(It first, size_t from, size_t to)
+    {
+        if (from > to)
+            std::rotate(first + to, first + from, first + from + 1);
+        else
+            std::rotate(first + from, first + from + 1, first + to + 1);
+    }
+}
 
 SortingController::SortingController()
-    : m_phase(HIGHLIGHT)
-    , m_currentIndex(0)
-    , m_lastSortedIndex(0)
+    : m_totalSteps(0)
     , m_isComplete(false)
     , m_isSwapping(false)
-    , m_comparisonCount(0)
-    , m_swapCount(0)
-    , m_outerIdx(1)
-    , m_innerIdx(1)
-    , m_minIndex(0)
 {
 }
 
-bool SortingController::step()
+SortingController::~SortingController()
 {
-    switch (m_algorithm)
-    {
-    case BUBBLE:
-        return bubbleSortStep();
+    stopCounting();
+}
 
-    case INSERTION:
-        return insertionSortStep();
+size_t SortingController::totalSteps() const
+{
+    const size_t total = m_totalSteps.load(std::memory_order_acquire);
+    return total == kNone ? 0 : total;
+}
 
-    case SELECTION:
-        return selectionSortStep();
+bool SortingController::isLengthKnown() const
+{
+    return m_totalSteps.load(std::memory_order_acquire) != kNone;
+}
 
-    // More algorithm adding
+QString SortingController::totalStepsText() const
+{
+    return isLengthKnown() ? QString::number(qulonglong(totalSteps())) : QString("?");
+}
 
-    default:
-        // should never happen, but safe fallback
-        return false;
+void SortingController::startCounting()
+{
+    stopCounting();
+    /* A parallel algorithm is counted untraced, which ParallelSort does
+       in a fraction of the time of stepping it and without its traces */
+    if (m_keys.size() <= kInlineCountLimit || SortEngine::isParallel(m_algorithm)) {
+        std::vector<int> dryRun = m_keys;
+        m_totalSteps = SortEngine::run(m_algorithm, dryRun).events;
+        return;
     }
+
+    // Stepping a copy, rather than run(), lets a new reset cancel the count
+    m_totalSteps = kNone;
+    m_cancelCount = false;
+    m_counter = std::thread([this, algorithm = m_algorithm, keys = m_keys]() mutable {
+        SortStepper stepper = SortEngine::steps(algorithm, keys);
+        TraceEvent e;
+        size_t events = 0;
+        while (stepper.next(e)) {
+            if ((++events & 4095) == 0 && m_cancelCount.load(std::memory_order_relaxed))
+                return;
+        }
+        // Stepping to the end may have found the length first
+        size_t unknown = kNone;
+        m_totalSteps.compare_exchange_strong(unknown, events, std::memory_order_release);
+    });
 }
 
-void SortingController::setBlocks(std::vector<PhysicsBlock*>& blocks)
+void SortingController::stopCounting()
 {
-    m_blocks = blocks;
-    reset();
+    if (!m_counter.joinable())
+        return;
+    m_cancelCount = true;
+    m_counter.join();
 }
 
-bool SortingController::bubbleSortStep()
+bool SortingController::step()
 {
-    if (m_isComplete || m_blocks.size() < 2)
+    if (m_isComplete || m_order.size() < 2)
         return false;
 
+    /* wait for any current swap animation to finish */
     if (m_isSwapping) {
-        bool stillMoving = false;
-        for (auto block : m_blocks) {
-            if (block->isMoving()) {
-                stillMoving = true;
-                break;
-            }
-        }
-        if (stillMoving)
-            return true;
-
+        if (isAnimating()) return true;
         m_isSwapping = false;
-        for (auto block : m_blocks)
-            block->highlight(false);
+        clearHighlights();
     }
 
-    if (!m_isComplete && !m_isSwapping && m_phase == HIGHLIGHT) {
-        saveState();
+    TraceEvent e;
+    if (!nextEvent(e)) {
+        finish();
+        return false;
     }
 
-    if (m_phase == HIGHLIGHT) {
-        for (auto block : m_blocks)
-            block->highlight(false);
-
-        if (m_currentIndex + 1 >= m_blocks.size() - m_lastSortedIndex) {
-            m_lastSortedIndex++;
-            m_currentIndex = 0;
-            if (m_lastSortedIndex >= m_blocks.size() - 1) {
-
-                m_isComplete = true;
-                if (statusCallback)
-                    statusCallback("Bubble Sort complete!");
-                for (auto* block : m_blocks)
-                    block->highlight(true, true); // ← green = sorted
-                for (size_t i = 0; i < m_blocks.size(); ++i)
-                    m_blocks[i]->moveToPosition(i);
-                return false;
-            }
+    if (SortEngine::isNetwork(m_algorithm)) {
+        applyLayer(e);
+        return true;
+    }
+
+    applyEvent(e);
+    if (SortEngine::isParallel(m_algorithm))
+        tintWorker(e);
+    checkpointIfDue();
+    return true;
+}
+
+bool SortingController::isAnimating() const
+{
+    if (!m_isSwapping)
+        return false;
+    if (animatingCallback)
+        return animatingCallback();
+    for (auto *b : m_blocks)
+        if (b->isMoving()) return true;
+    return false;
+}
+
+void SortingController::tintWorker(const TraceEvent& e)
+{
+    if (m_blocks.empty())
+        return;
+    if (e.op == TraceEvent::COMPARE || e.op == TraceEvent::SWAP || e.op == TraceEvent::MOVE) {
+        m_blocks[e.a]->setWorker(m_currentWorker);
+        m_blocks[e.b]->setWorker(m_currentWorker);
+    }
+}
+
+void SortingController::rebuildWorkerTints()
+{
+    if (m_initialBlocks.empty())
+        return;
+
+    std::vector<uint32_t> order(m_initialBlocks.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::vector<int> workers(order.size(), -1);
+    int current = -1;
+
+    m_log.forEachApplied([&](const TraceEvent& e) {
+        switch (e.op) {
+        case TraceEvent::TASK:
+            current = int(e.a);
+            return;
+        case TraceEvent::SWAP:
+            std::swap(order[e.a], order[e.b]);
+            break;
+        case TraceEvent::MOVE:
+            rotateOne(order.begin(), e.a, e.b);
+            break;
+        case TraceEvent::COMPARE:
+            break;
+        default:
+            return;
         }
+        workers[order[e.a]] = current;
+        workers[order[e.b]] = current;
+    });
 
-        PhysicsBlock* b1 = m_blocks[m_currentIndex];
-        PhysicsBlock* b2 = m_blocks[m_currentIndex + 1];
-        b1->highlight(true);
-        b2->highlight(true);
-        if (statusCallback)
-            statusCallback(QString("Comparing elements at index %1 and %2")
-                               .arg(m_currentIndex)
-                               .arg(m_currentIndex + 1));
+    m_currentWorker = current;
+    for (size_t i = 0; i < m_initialBlocks.size(); ++i)
+        m_initialBlocks[i]->setWorker(workers[i]);
+}
 
-        m_comparisonCount++;
-        m_phase = ACTION;
+bool SortingController::nextEvent(TraceEvent& e)
+{
+    if (m_log.redo(e))
         return true;
+    if (!m_stepper.next(e)) {
+        m_totalSteps = m_log.size();    // Known now even if still being counted
+        return false;
     }
+    m_log.push(e);
+    return true;
+}
 
-    else {
-        PhysicsBlock* b1 = m_blocks[m_currentIndex];
-        PhysicsBlock* b2 = m_blocks[m_currentIndex + 1];
-        if (b1->getValue() > b2->getValue()) {
-            int val1 = b1->getValue();
-            int val2 = b2->getValue();
-            performSwap(m_currentIndex, m_currentIndex + 1);
-            if (statusCallback)
-                statusCallback(QString("Swapping %1 and %2").arg(val1).arg(val2));
-            m_swapCount++;
+void SortingController::applyLayer(TraceEvent e)
+{
+    clearHighlights();
+
+    // The pairs of a layer are disjoint, so every swap can animate at once
+    int compares = 0;
+    int swaps = 0;
+    for (;;) {
+        SortEngine::count(m_stats, e, &m_cache);
+        if (e.op == TraceEvent::COMPARE) {
+            highlightPair(e.a, e.b);
+            ++compares;
+        } else if (e.op == TraceEvent::SWAP) {
+            performSwap(e.a, e.b);
+            ++swaps;
             m_isSwapping = true;
         }
-        m_currentIndex++;
-        m_phase = HIGHLIGHT;
-        return true;
+        checkpointIfDue();
+        if (e.op == TraceEvent::LAYER || !nextEvent(e))
+            break;
     }
+
+    if (statusCallback)
+        statusCallback(QString("Layer %1: %2 compare-exchanges, %3 swaps")
+                           .arg(e.a + 1).arg(compares).arg(swaps));
 }
 
-bool SortingController::insertionSortStep()
+void SortingController::checkpointIfDue()
 {
-    if (m_isComplete || m_blocks.size() < 2) return false;
+    if (m_log.checkpointDue())
+        m_log.addCheckpoint(m_stats, m_order, m_cache);
+    else if (m_log.cacheCheckpointDue())
+        m_log.addCacheCheckpoint(m_stats, m_cache);
+}
 
-    /* wait for any current swap animation to finish */
-    if (m_isSwapping) {
-        for (auto *b : m_blocks)
-            if (b->isMoving()) return true;
-        m_isSwapping = false;
-        for (auto *b : m_blocks) b->highlight(false);
+void SortingController::syncCache()
+{
+    const UndoLog::Checkpoint& cp = m_log.cacheCheckpointBefore(m_log.position());
+    m_cache = cp.cache;
+
+    SortEngine::Stats replayed;
+    m_log.forEachApplied([&](const TraceEvent& e) {
+        SortEngine::count(replayed, e, &m_cache);
+    }, &cp);
+    m_stats.cacheMisses = cp.stats.cacheMisses + replayed.cacheMisses;
+}
+
+void SortingController::seek(size_t step)
+{
+    if (m_order.size() < 2)
+        return;
+
+    const size_t target = isLengthKnown() ? std::min(step, totalSteps()) : step;
+    const size_t from = m_log.position();
+    const size_t distance = target > from ? target - from : from - target;
+
+    m_isComplete = false;
+    m_isSwapping = false;
+
+    // Restart from the checkpoint if that replays less than walking from here
+    const UndoLog::Checkpoint& cp = m_log.checkpointBefore(target);
+    if (target - cp.step + m_order.size() < distance) {
+        m_log.rewind(cp);
+        m_order = cp.order;
+        m_stats = cp.stats;
+        m_cache = cp.cache;
     }
 
-    if (!m_isComplete && !m_isSwapping && m_phase == HIGHLIGHT) {
-        saveState();
+    // Walking forward keeps the simulated cache current; walking back does not
+    bool cacheCurrent = true;
+    TraceEvent e;
+    while (m_log.position() > target && m_log.undo(e)) {
+        replay(e, false);
+        cacheCurrent = false;
+    }
+    while (m_log.position() < target && nextEvent(e)) {
+        replay(e, true);
+        checkpointIfDue();
     }
+    if (!cacheCurrent)
+        syncCache();
 
-    if (m_phase == HIGHLIGHT) {
-        /* end of inner scan? */
-        if (m_innerIdx == 0 ||
-            m_blocks[m_innerIdx - 1]->getValue() <= m_blocks[m_innerIdx]->getValue())
-        {
-            ++m_outerIdx;
-            if (m_outerIdx >= m_blocks.size()) {
-                m_isComplete = true;
-                if (statusCallback)
-                    statusCallback("Insertion Sort complete!");
-
-                // 1) Highlight sorted
-                for (auto* block : m_blocks)
-                    block->highlight(true, true);
-
-                // 2) Reposition all blocks
-                for (size_t i = 0; i < m_blocks.size(); ++i)
-                    m_blocks[i]->moveToPosition(i);
-
-                // 3) End
-                return false;
+    // Send every block straight to its slot at the target step
+    placeBlocks(distance <= kAnimatedSeekLimit);
+
+    if (isLengthKnown() && m_log.position() == totalSteps()) {
+        finish();
+        return;
+    }
+    reapplyHighlights();
+    if (statusCallback)
+        statusCallback(QString("Jumped to step %1 of %2").arg(target).arg(totalStepsText()));
+}
+
+bool SortingController::turbo(size_t maxSteps, std::chrono::microseconds budget)
+{
+    if (m_isComplete || m_order.size() < 2)
+        return false;
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline = Clock::now() + budget;
+    const bool network = SortEngine::isNetwork(m_algorithm);
+    const bool parallel = SortEngine::isParallel(m_algorithm) && !m_blocks.empty();
+
+    // Tints by initial block; kUnchanged marks blocks no task touched
+    constexpr int kUnchanged = -2;
+    std::vector<int> tints(parallel ? m_order.size() : 0, kUnchanged);
+
+    m_isSwapping = false;
+    size_t steps = 0;
+    size_t events = 0;
+    bool expired = false;
+    bool running = true;
+    TraceEvent e;
+    for (;;) {
+        if (!nextEvent(e)) {
+            running = false;
+            break;
+        }
+        replay(e, true);
+        checkpointIfDue();
+
+        if (parallel) {
+            if (e.op == TraceEvent::TASK) {
+                m_currentWorker = int(e.a);
+            } else if (e.op == TraceEvent::COMPARE || e.op == TraceEvent::SWAP
+                       || e.op == TraceEvent::MOVE) {
+                tints[m_order[e.a]] = m_currentWorker;
+                tints[m_order[e.b]] = m_currentWorker;
             }
-            m_innerIdx = m_outerIdx;
         }
 
-        m_blocks[m_innerIdx]->highlight(true);
-        m_blocks[m_innerIdx - 1]->highlight(true);
+        // Reading the clock is slower than an event, so only look now and then
+        if ((++events & 63) == 0)
+            expired = Clock::now() >= deadline;
+        if (network && e.op != TraceEvent::LAYER)
+            continue;
+        if (++steps >= maxSteps || expired)
+            break;
+    }
 
-        if (statusCallback)
-            statusCallback(QString("Comparing index %1 with index %2")
-                               .arg(m_innerIdx).arg(m_innerIdx - 1));
+    placeBlocks(false);
+    for (size_t i = 0; i < tints.size(); ++i)
+        if (tints[i] != kUnchanged)
+            m_initialBlocks[i]->setWorker(tints[i]);
 
-        ++m_comparisonCount;
-        m_phase = ACTION;
-        return true;
+    if (!running) {
+        finish();
+        return false;
     }
-    else {                                  /* ACTION */
-        if (m_blocks[m_innerIdx - 1]->getValue() > m_blocks[m_innerIdx]->getValue()) {
-            int val1 = m_blocks[m_innerIdx - 1]->getValue();
-            int val2 = m_blocks[m_innerIdx]->getValue();
-            performSwap(m_innerIdx - 1, m_innerIdx);
-
-            if (statusCallback)
-                statusCallback(QString("Swapping %1 and %2").arg(val1).arg(val2));
-            ++m_swapCount;
-            m_isSwapping = true;
-        }
-        if (m_innerIdx > 0) --m_innerIdx;
-        m_phase = HIGHLIGHT;
-        return true;
+
+    clearHighlights();
+    TraceEvent last;
+    if (m_log.lastCompare(last))
+        highlightPair(last.a, last.b);
+
+    if (statusCallback)
+        statusCallback(QString("Turbo: %1 steps, at step %2 of %3")
+                           .arg(steps).arg(m_log.position()).arg(totalStepsText()));
+    return true;
+}
+
+void SortingController::placeBlocks(bool animate)
+{
+    if (m_blocks.empty())
+        return;
+    for (size_t i = 0; i < m_order.size(); ++i) {
+        PhysicsBlock* block = m_initialBlocks[m_order[i]];
+        if (m_blocks[i] == block && !(block->isMoving() && !animate))
+            continue;
+        m_blocks[i] = block;
+        if (animate)
+            block->moveToPosition(i);
+        else
+            block->placeAtPosition(i);
     }
 }
 
-bool SortingController::selectionSortStep()
+void SortingController::applyEvent(const TraceEvent& e)
 {
-    // Terminate if sorting is complete or array size is less than 2
-    if (m_isComplete || m_blocks.size() < 2) return false;
+    SortEngine::count(m_stats, e, &m_cache);
 
-    // Wait if a swap animation is in progress
-    if (m_isSwapping) {
-        for (auto *b : m_blocks)
-            if (b->isMoving()) return true;
-        m_isSwapping = false;
-        for (auto *b : m_blocks) b->highlight(false);
+    switch (e.op) {
+    case TraceEvent::COMPARE:
+        clearHighlights();
+        highlightPair(e.a, e.b);
+
+        if (statusCallback)
+            statusCallback(QString("Comparing elements at index %1 and %2")
+                               .arg(e.a).arg(e.b));
+        break;
+
+    case TraceEvent::SWAP: {
+        int val1 = valueAt(e.a);
+        int val2 = valueAt(e.b);
+        performSwap(e.a, e.b);
+
+        if (statusCallback)
+            statusCallback(QString("Swapping %1 and %2").arg(val1).arg(val2));
+        m_isSwapping = true;
+        break;
     }
 
-    if (!m_isComplete && !m_isSwapping && m_phase == HIGHLIGHT) {
-        saveState();
+    case TraceEvent::MOVE: {
+        int val = valueAt(e.a);
+        performMove(e.a, e.b);
+
+        if (statusCallback)
+            statusCallback(QString("Moving %1 from index %2 to index %3")
+                               .arg(val).arg(e.a).arg(e.b));
+        m_isSwapping = true;
+        break;
     }
 
-    if (m_phase == HIGHLIGHT) {
-        // Clear highlights from all blocks
-        for (auto *b : m_blocks) b->highlight(false);
+    case TraceEvent::FOCUS:
+        if (!statusCallback)
+            break;
+        if (m_algorithm == SELECTION)
+            statusCallback(QString("New minimum found at index %1").arg(e.a));
+        else if (m_algorithm == QUICK)
+            statusCallback(QString("Partitioning around pivot %1 at index %2")
+                               .arg(valueAt(e.a)).arg(e.a));
+        else
+            statusCallback(QString("Focusing on index %1").arg(e.a));
+        break;
 
-        // Check if there are more elements to compare in the current pass
-        if (m_currentIndex < m_blocks.size()) {
-            // Highlight the current element and the current minimum
-            m_blocks[m_currentIndex]->highlight(true);
-            m_blocks[m_minIndex]->highlight(true);
+    case TraceEvent::LAYER:
+        break;
 
-            if (statusCallback)
-                statusCallback(QString("Comparing index %1 with current min at index %2")
-                                   .arg(m_currentIndex).arg(m_minIndex));
+    case TraceEvent::TASK:
+        m_currentWorker = int(e.a);
+        if (statusCallback)
+            statusCallback(QString("Worker %1 takes a task starting at index %2")
+                               .arg(e.a).arg(e.b));
+        break;
+    }
+}
 
-            m_comparisonCount++;
-            m_phase = ACTION;
-            return true;
-        } else {
-            // Pass complete: swap the minimum with m_lastSortedIndex
-            if (m_minIndex != m_lastSortedIndex) {
+void SortingController::revertEvent(const TraceEvent& e)
+{
+    SortEngine::uncount(m_stats, e);
 
-                int val1 = m_blocks[m_minIndex]->getValue();
-                int val2 = m_blocks[m_lastSortedIndex]->getValue();
+    switch (e.op) {
+    case TraceEvent::COMPARE:
+        break;
 
-                performSwap(m_minIndex, m_lastSortedIndex);
+    case TraceEvent::SWAP:
+        performSwap(e.a, e.b);
+        break;
 
-                if (statusCallback)
-                    statusCallback(QString("Swapping %1 and %2").arg(val1).arg(val2));
+    case TraceEvent::MOVE:
+        performMove(e.b, e.a);
+        break;
 
-                m_swapCount++;
-                m_isSwapping = true;
-            }
-            // Move to the next pass
-            m_lastSortedIndex++;
-            if (m_lastSortedIndex >= m_blocks.size() - 1) {
-                // Sorting complete
-                m_isComplete = true;
-                if (statusCallback)
-                    statusCallback("Selection Sort complete!");
-                for (auto* block : m_blocks)
-                    block->highlight(true, true); // green
-                for (size_t i = 0; i < m_blocks.size(); ++i)
-                    m_blocks[i]->moveToPosition(i);
-                return false;
-            }
-            // Start a new pass: reset indices
-            m_currentIndex = m_lastSortedIndex + 1;
-            m_minIndex = m_lastSortedIndex;
-            m_phase = HIGHLIGHT;
-            return true;
-        }
-    } else { // ACTION
-        // Update the minimum value
-        if (m_blocks[m_currentIndex]->getValue() < m_blocks[m_minIndex]->getValue()) {
-            m_minIndex = m_currentIndex;
+    case TraceEvent::FOCUS:
+    case TraceEvent::LAYER:
+    case TraceEvent::TASK:
+        break;
+    }
+}
 
-            if (statusCallback)
-                statusCallback(QString("New minimum found at index %1").arg(m_minIndex));
-        }
-        // Move to the next element
-        m_currentIndex++;
-        m_phase = HIGHLIGHT;
-        return true;
+void SortingController::replay(const TraceEvent& e, bool forward)
+{
+    if (forward)
+        SortEngine::count(m_stats, e, &m_cache);
+    else
+        SortEngine::uncount(m_stats, e);
+
+    switch (e.op) {
+    case TraceEvent::COMPARE:
+        break;
+
+    case TraceEvent::SWAP:
+        std::swap(m_order[e.a], m_order[e.b]);
+        break;
+
+    case TraceEvent::MOVE:
+        if (forward)
+            rotateOne(m_order.begin(), e.a, e.b);
+        else
+            rotateOne(m_order.begin(), e.b, e.a);
+        break;
+
+    case TraceEvent::FOCUS:
+    case TraceEvent::LAYER:
+    case TraceEvent::TASK:
+        break;
     }
 }
 
+void SortingController::finish()
+{
+    m_isComplete = true;
+    m_activeA = m_activeB = kNone;
+    if (statusCallback)
+        statusCallback(QString("%1 complete!").arg(SortEngine::name(m_algorithm)));
+
+    for (auto* block : m_blocks)
+        block->highlight(true, true); // green = sorted
+    for (size_t i = 0; i < m_blocks.size(); ++i)
+        m_blocks[i]->moveToPosition(i);
+}
+
+void SortingController::setBlocks(std::vector<PhysicsBlock*>& blocks)
+{
+    m_blocks = blocks;
+    m_initialKeys.clear();
+    m_order.clear();
+    reset();
+}
+
+void SortingController::setKeys(std::vector<int> keys)
+{
+    m_blocks.clear();
+    m_initialKeys = std::move(keys);
+    m_order.clear();
+    reset();
+}
+
+void SortingController::clearHighlights()
+{
+    m_activeA = m_activeB = kNone;
+    for (auto *b : m_blocks)
+        b->highlight(false);
+}
+
+void SortingController::highlightPair(size_t a, size_t b)
+{
+    m_activeA = a;
+    m_activeB = b;
+    if (!m_blocks.empty()) {
+        m_blocks[a]->highlight(true);
+        m_blocks[b]->highlight(true);
+    }
+}
+
+bool SortingController::activePair(size_t& a, size_t& b) const
+{
+    if (m_activeA == kNone)
+        return false;
+    a = m_activeA;
+    b = m_activeB;
+    return true;
+}
 
 void SortingController::performSwap(size_t index1, size_t index2)
 {
+    std::swap(m_order[index1], m_order[index2]);
+    if (m_blocks.empty())
+        return;
+
     // Swap the blocks in our array
     std::swap(m_blocks[index1], m_blocks[index2]);
 
@@ -295,6 +551,17 @@ void SortingController::performSwap(size_t index1, size_t index2)
     block2->moveToPosition(index2);
 }
 
+void SortingController::performMove(size_t from, size_t to)
+{
+    rotateOne(m_order.begin(), from, to);
+    if (m_blocks.empty())
+        return;
+
+    rotateOne(m_blocks.begin(), from, to);
+    for (size_t i = std::min(from, to); i <= std::max(from, to); ++i)
+        m_blocks[i]->moveToPosition(i);
+}
+
 bool SortingController::isSortingComplete() const
 {
     return m_isComplete;
@@ -302,104 +569,86 @@ bool SortingController::isSortingComplete() const
 
 void SortingController::reset()
 {
-    m_phase = HIGHLIGHT;
-    m_lastSortedIndex = 0;
     m_isComplete      = false;
     m_isSwapping      = false;
-    m_comparisonCount = 0;
-    m_swapCount       = 0;
-
-    // For bubble and insertion, start comparing at index 0.
-    // For selection, start at index 1 vs index 0.
-    if (m_algorithm == SELECTION) {
-        m_minIndex     = m_lastSortedIndex;       // = 0
-        m_currentIndex = m_lastSortedIndex + 1;   // = 1
-    } else {
-        m_minIndex     = 0;
-        m_currentIndex = 0;
+    m_stats           = SortEngine::Stats();
+    m_cache.clear();
+
+    // Restart over the values as they stand now
+    if (!m_blocks.empty()) {
+        m_initialKeys.clear();
+        m_initialKeys.reserve(m_blocks.size());
+        for (PhysicsBlock* block : m_blocks)
+            m_initialKeys.push_back(block->getValue());
+    } else if (m_order.size() == m_initialKeys.size()) {
+        std::vector<int> current(m_order.size());
+        for (size_t i = 0; i < m_order.size(); ++i)
+            current[i] = m_initialKeys[m_order[i]];
+        m_initialKeys.swap(current);
     }
 
-    // Insertion-sort uses these; bubble ignores them.
-    m_outerIdx = 1;
-    m_innerIdx = 1;
+    m_initialBlocks = m_blocks;
+    m_order.resize(m_initialKeys.size());
+    std::iota(m_order.begin(), m_order.end(), 0u);
+
+    // Restart the algorithm on a mirror of those values; step() pulls its
+    // events one at a time.
+    m_keys = m_initialKeys;
+
+    // Count the length of the timeline before m_stepper touches m_keys
+    startCounting();
+    m_stepper = SortEngine::steps(m_algorithm, m_keys);
 
-    // Reset highlights on all blocks
+    // Reset highlights and worker tints on all blocks
+    m_currentWorker = -1;
+    m_activeA = m_activeB = kNone;
     for (PhysicsBlock* block : m_blocks) {
+        block->setWorker(-1);
         block->highlight(false);
     }
 
     // Clear undo history
-    history.clear();
-}
-
-void SortingController::saveState() {
-    SortState snapshot;
-    snapshot.phase = m_phase;
-    snapshot.currentIndex = m_currentIndex;
-    snapshot.lastSortedIndex = m_lastSortedIndex;
-    snapshot.isComplete = m_isComplete;
-    snapshot.isSwapping = m_isSwapping;
-    snapshot.comparisonCount = m_comparisonCount;
-    snapshot.swapCount = m_swapCount;
-    snapshot.outerIdx = m_outerIdx;
-    snapshot.innerIdx = m_innerIdx;
-    snapshot.minIndex = m_minIndex;
-    snapshot.algorithm = m_algorithm;
-
-    // Save block order
-    snapshot.blocks = m_blocks;
-
-    history.push_back(snapshot);
+    m_log.clear(std::max(kMinCheckpointInterval, 16 * m_order.size()), kCacheCheckpointInterval);
+    m_log.addCheckpoint(m_stats, m_order, m_cache);
 }
 
 bool SortingController::restoreState() {
-    if (history.empty())
+    // Undoing the final step only takes the "sorted" colouring away
+    if (m_isComplete) {
+        m_isComplete = false;
+        reapplyHighlights();
+        return true;
+    }
+
+    TraceEvent e;
+    if (!m_log.undo(e))
         return false;
 
-    // Pop the last snapshot
-    SortState prev = history.back();
-    history.pop_back();
-
-    // Restore all controller fields
-    m_phase           = prev.phase;
-    m_currentIndex    = prev.currentIndex;
-    m_lastSortedIndex = prev.lastSortedIndex;
-    m_isComplete      = prev.isComplete;
-    m_isSwapping      = prev.isSwapping;
-    m_comparisonCount = prev.comparisonCount;
-    m_swapCount       = prev.swapCount;
-    m_outerIdx        = prev.outerIdx;
-    m_innerIdx        = prev.innerIdx;
-    m_minIndex        = prev.minIndex;
-    m_algorithm       = prev.algorithm;
-
-    // Restore the block order
-    m_blocks = prev.blocks;
-
-    // Animate blocks back to their stored positions,
-    // and clear any existing highlight on each:
-    for (size_t i = 0; i < m_blocks.size(); ++i) {
-        m_blocks[i]->moveToPosition(i);
-        m_blocks[i]->highlight(false);
-    }
+    m_isSwapping = false;
+    revertEvent(e);
 
-    // If we've just popped the *last* snapshot (history is now empty),
-    // that means we're back at the very beginning—no highlights at all.
-    if (history.empty()) {
-        // Nothing more to do; all blocks remain un-highlighted.
-        return true;
+    // A network step is a whole layer: undo back to the previous LAYER
+    if (SortEngine::isNetwork(m_algorithm)) {
+        TraceEvent previous;
+        while (m_log.previous(previous) && previous.op != TraceEvent::LAYER) {
+            m_log.undo(e);
+            revertEvent(e);
+        }
     }
+    syncCache();
 
-    // Otherwise, re-apply the correct two-block (or full-green) highlights
+    // Re-apply the comparison highlights of that moment
     reapplyHighlights();
     return true;
 }
 
 void SortingController::reapplyHighlights()
 {
+    if (SortEngine::isParallel(m_algorithm))
+        rebuildWorkerTints();
+
     // 1) Clear all highlights first
-    for (auto *b : m_blocks)
-        b->highlight(false);
+    clearHighlights();
 
     // 2) If we’re fully sorted, color them all green
     if (m_isComplete) {
@@ -408,28 +657,8 @@ void SortingController::reapplyHighlights()
         return;
     }
 
-    // 3) Otherwise, re-highlight based on algorithm & phase
-    switch (m_algorithm) {
-    case BUBBLE:
-        if (m_phase == HIGHLIGHT && m_currentIndex + 1 < m_blocks.size()) {
-            m_blocks[m_currentIndex]    ->highlight(true);
-            m_blocks[m_currentIndex + 1]->highlight(true);
-        }
-        break;
-
-    case INSERTION:
-        if (m_phase == HIGHLIGHT && m_innerIdx < m_blocks.size()) {
-            m_blocks[m_innerIdx]          ->highlight(true);
-            if (m_innerIdx > 0)
-                m_blocks[m_innerIdx - 1]->highlight(true);
-        }
-        break;
-
-    case SELECTION:
-        if (m_phase == HIGHLIGHT && m_currentIndex < m_blocks.size()) {
-            m_blocks[m_currentIndex]->highlight(true);
-            m_blocks[m_minIndex]   ->highlight(true);
-        }
-        break;
-    }
+    // 3) Otherwise, re-highlight the last compared pair
+    TraceEvent last;
+    if (m_log.lastCompare(last))
+        highlightPair(last.a, last.b);
 }
@@ -0,0 +1,33 @@
+/**
+ * tween.cpp
+ *
+ * This file implements the Tween class which eases a value from one number
+ * to another over a fixed time.
+ */
+#include "tween.h"
+#include <algorithm>
+
+Tween::Tween(float from, float to, float duration, Easing easing)
+    : m_from(from)
+    , m_to(to)
+    , m_duration(std::max(duration, 0.0f))
+    , m_easing(easing)
+{
+}
+
+float Tween::advance(float dt)
+{
+    m_elapsed = std::min(m_elapsed + dt, m_duration);
+    return value();
+}
+
+float Tween::value() const
+{
+    if (isFinished())
+        return m_to;
+
+    float t = m_elapsed / m_duration;
+    if (m_easing == EASE_IN_OUT)
+        t = t * t * (3.0f - 2.0f * t);  // Smoothstep: zero speed at both ends
+    return m_from + (m_to - m_from) * t;
+}
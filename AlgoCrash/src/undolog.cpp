@@ -0,0 +1,258 @@
+/**
+ * undolog.cpp
+ *
+ * This file implements the UndoLog class: the byte-level delta encoding of
+ * applied sort events and the forward/backward walks over it.
+ */
+#include "undolog.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+    constexpr uint8_t kOpMask      = 0x07;
+    constexpr uint8_t kTrailerOp   = 0x07;  // Never a real opcode
+    constexpr uint8_t kBNext       = 0;     // b = a + 1
+    constexpr uint8_t kBPrev       = 1;     // b = a - 1
+    constexpr uint8_t kBSame       = 2;     // b = a (single-index events)
+    constexpr uint8_t kBLong       = 3;
+    constexpr uint8_t kDeltaLong   = 7;
+
+    uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+    int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+    void putVarint(std::vector<uint8_t>& out, uint64_t v)
+    {
+        while (v >= 0x80) {
+            out.push_back(uint8_t(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(uint8_t(v));
+    }
+
+    uint64_t getVarint(const std::vector<uint8_t>& in, size_t& pos)
+    {
+        uint64_t v = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t byte = in[pos++];
+            v |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return v;
+        }
+    }
+
+    /* Decodes the record starting at @p pos; @p lastA is the a of the
+       previous record on entry and of this record on return. */
+    TraceEvent decodeForward(const std::vector<uint8_t>& bytes, size_t& pos, uint32_t& lastA)
+    {
+        const uint8_t header = bytes[pos++];
+        const uint8_t bCode = (header >> 3) & 0x03;
+        const uint8_t dCode = header >> 5;
+
+        int64_t da = dCode == kDeltaLong ? unzigzag(getVarint(bytes, pos)) : unzigzag(dCode);
+        const uint32_t a = uint32_t(int64_t(lastA) + da);
+
+        uint32_t b = a;
+        switch (bCode) {
+        case kBNext: b = a + 1; break;
+        case kBPrev: b = a - 1; break;
+        case kBSame: b = a;     break;
+        case kBLong: b = uint32_t(int64_t(a) + unzigzag(getVarint(bytes, pos))); break;
+        }
+
+        if (bCode == kBLong || dCode == kDeltaLong)
+            ++pos; // trailer
+
+        lastA = a;
+        return { static_cast<TraceEvent::Op>(header & kOpMask), a, b };
+    }
+}
+
+void UndoLog::clear(size_t checkpointInterval, size_t cacheCheckpointInterval)
+{
+    m_bytes.clear();
+    m_offset = 0;
+    m_position = 0;
+    m_size = 0;
+    m_lastA = 0;
+    m_checkpointInterval = checkpointInterval;
+    m_cacheCheckpointInterval = cacheCheckpointInterval;
+    m_checkpoints.clear();
+    m_cacheCheckpoints.clear();
+}
+
+void UndoLog::push(const TraceEvent& e)
+{
+    assert(m_position == m_size);
+
+    const int64_t da = int64_t(e.a) - int64_t(m_lastA);
+    const int64_t db = int64_t(e.b) - int64_t(e.a);
+
+    uint8_t bCode = kBLong;
+    if (db == 1)       bCode = kBNext;
+    else if (db == -1) bCode = kBPrev;
+    else if (db == 0)  bCode = kBSame;
+
+    const uint64_t zda = zigzag(da);
+    const uint8_t dCode = zda < kDeltaLong ? uint8_t(zda) : kDeltaLong;
+
+    const size_t start = m_bytes.size();
+    m_bytes.push_back(uint8_t(e.op) | uint8_t(bCode << 3) | uint8_t(dCode << 5));
+    if (dCode == kDeltaLong)
+        putVarint(m_bytes, zda);
+    if (bCode == kBLong)
+        putVarint(m_bytes, zigzag(db));
+    if (dCode == kDeltaLong || bCode == kBLong) {
+        const size_t length = m_bytes.size() - start + 1;
+        m_bytes.push_back(uint8_t(length << 3) | kTrailerOp);
+    }
+
+    m_lastA = e.a;
+    m_offset = m_bytes.size();
+    ++m_position;
+    ++m_size;
+}
+
+TraceEvent UndoLog::decodeBackward(const std::vector<uint8_t>& bytes, size_t& end,
+                                   uint32_t& lastA)
+{
+    const uint8_t last = bytes[end - 1];
+    size_t start = end - 1;
+    if ((last & kOpMask) == kTrailerOp)
+        start = end - (last >> 3);
+
+    // lastA currently holds this record's a; recover the previous one.
+    uint32_t prevA = 0;
+    size_t pos = start;
+    const uint8_t dCode = bytes[start] >> 5;
+    int64_t da = 0;
+    if (dCode == kDeltaLong) {
+        size_t p = start + 1;
+        da = unzigzag(getVarint(bytes, p));
+    } else {
+        da = unzigzag(dCode);
+    }
+    prevA = uint32_t(int64_t(lastA) - da);
+
+    uint32_t a = prevA;
+    TraceEvent e = decodeForward(bytes, pos, a);
+
+    end = start;
+    lastA = prevA;
+    return e;
+}
+
+bool UndoLog::undo(TraceEvent& out)
+{
+    if (m_position == 0)
+        return false;
+
+    out = decodeBackward(m_bytes, m_offset, m_lastA);
+    --m_position;
+    return true;
+}
+
+bool UndoLog::redo(TraceEvent& out)
+{
+    if (m_position == m_size)
+        return false;
+
+    out = decodeForward(m_bytes, m_offset, m_lastA);
+    ++m_position;
+    return true;
+}
+
+bool UndoLog::previous(TraceEvent& out) const
+{
+    if (m_position == 0)
+        return false;
+
+    size_t end = m_offset;
+    uint32_t lastA = m_lastA;
+    out = decodeBackward(m_bytes, end, lastA);
+    return true;
+}
+
+bool UndoLog::lastCompare(TraceEvent& out) const
+{
+    size_t end = m_offset;
+    uint32_t lastA = m_lastA;
+    while (end > 0) {
+        out = decodeBackward(m_bytes, end, lastA);
+        if (out.op == TraceEvent::COMPARE)
+            return true;
+    }
+    return false;
+}
+
+void UndoLog::forEachApplied(const std::function<void(const TraceEvent&)>& f,
+                             const Checkpoint* from) const
+{
+    assert(!from || from->step <= m_position);
+
+    size_t pos = from ? from->offset : 0;
+    uint32_t lastA = from ? from->lastA : 0;
+    while (pos < m_offset)
+        f(decodeForward(m_bytes, pos, lastA));
+}
+
+bool UndoLog::checkpointDue() const
+{
+    return m_checkpointInterval > 0
+        && m_position == m_size
+        && m_position % m_checkpointInterval == 0
+        && (m_checkpoints.empty() || m_checkpoints.back().step < m_position);
+}
+
+void UndoLog::addCheckpoint(const SortEngine::Stats& stats, const std::vector<uint32_t>& order,
+                            const CacheModel& cache)
+{
+    m_checkpoints.push_back({ m_position, m_offset, m_lastA, stats, order, cache });
+}
+
+const UndoLog::Checkpoint& UndoLog::checkpointBefore(size_t step) const
+{
+    assert(!m_checkpoints.empty());
+    auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), step,
+                               [](size_t s, const Checkpoint& c) { return s < c.step; });
+    return it == m_checkpoints.begin() ? *it : *(it - 1);
+}
+
+bool UndoLog::cacheCheckpointDue() const
+{
+    return m_cacheCheckpointInterval > 0
+        && m_position == m_size
+        && m_position % m_cacheCheckpointInterval == 0
+        && (m_cacheCheckpoints.empty() || m_cacheCheckpoints.back().step < m_position);
+}
+
+void UndoLog::addCacheCheckpoint(const SortEngine::Stats& stats, const CacheModel& cache)
+{
+    m_cacheCheckpoints.push_back({ m_position, m_offset, m_lastA, stats, {}, cache });
+}
+
+const UndoLog::Checkpoint& UndoLog::cacheCheckpointBefore(size_t step) const
+{
+    // Full checkpoints carry the cache too; take whichever is closer
+    const Checkpoint& full = checkpointBefore(step);
+    auto it = std::upper_bound(m_cacheCheckpoints.begin(), m_cacheCheckpoints.end(), step,
+                               [](size_t s, const Checkpoint& c) { return s < c.step; });
+    if (it == m_cacheCheckpoints.begin() || (it - 1)->step <= full.step)
+        return full;
+    return *(it - 1);
+}
+
+void UndoLog::rewind(const Checkpoint& c)
+{
+    m_position = c.step;
+    m_offset = c.offset;
+    m_lastA = c.lastA;
+}
+
+size_t UndoLog::byteSize() const
+{
+    size_t total = m_bytes.capacity();
+    for (const Checkpoint& c : m_checkpoints)
+        total += sizeof(Checkpoint) + c.order.capacity() * sizeof(uint32_t);
+    total += m_cacheCheckpoints.capacity() * sizeof(Checkpoint);
+    return total;
+}
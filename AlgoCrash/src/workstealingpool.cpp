@@ -0,0 +1,133 @@
+/**
+ * workstealingpool.cpp
+ *
+ * This file implements the WorkStealingPool class.
+ */
+#include "workstealingpool.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+    /* The pool and worker index of the calling thread, if any */
+    thread_local const WorkStealingPool* t_pool = nullptr;
+    thread_local unsigned t_index = 0;
+}
+
+WorkStealingPool::WorkStealingPool(unsigned workers)
+{
+    workers = std::max(1u, workers);
+    for (unsigned i = 0; i < workers; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+    for (unsigned i = 1; i < workers; ++i)
+        m_threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+WorkStealingPool& WorkStealingPool::shared()
+{
+    static WorkStealingPool pool(std::thread::hardware_concurrency());
+    return pool;
+}
+
+int WorkStealingPool::currentWorker() const
+{
+    return t_pool == this ? int(t_index) : -1;
+}
+
+void WorkStealingPool::run(const Job& job)
+{
+    std::lock_guard<std::mutex> lock(m_runMutex);
+    assert(!t_pool);
+
+    t_pool = this;
+    t_index = 0;
+    job();
+    t_pool = nullptr;
+}
+
+void WorkStealingPool::spawn(TaskGroup& group, Job job)
+{
+    assert(t_pool == this);
+
+    group.m_pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        Worker& self = *m_workers[t_index];
+        std::lock_guard<std::mutex> lock(self.mutex);
+        self.jobs.push_back([&group, job = std::move(job)] {
+            job();
+            group.m_pending.fetch_sub(1, std::memory_order_release);
+        });
+    }
+    m_queued.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders this against a worker about to sleep
+    { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+    m_wake.notify_one();
+}
+
+void WorkStealingPool::wait(TaskGroup& group)
+{
+    assert(t_pool == this);
+
+    while (group.m_pending.load(std::memory_order_acquire) > 0) {
+        if (!runOne(t_index))
+            std::this_thread::yield();
+    }
+}
+
+bool WorkStealingPool::runOne(unsigned self)
+{
+    Job job;
+    {
+        Worker& own = *m_workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+        }
+    }
+
+    for (unsigned i = 1; !job && i < m_workers.size(); ++i) {
+        Worker& victim = *m_workers[(self + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+        }
+    }
+
+    if (!job)
+        return false;
+
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    job();
+    return true;
+}
+
+void WorkStealingPool::workerLoop(unsigned index)
+{
+    t_pool = this;
+    t_index = index;
+
+    for (;;) {
+        if (runOne(index))
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this] {
+            return m_stop || m_queued.load(std::memory_order_acquire) > 0;
+        });
+        if (m_stop)
+            return;
+    }
+}